@@ -562,6 +562,7 @@ const MCExpr *EpiphanyAsmParser::evaluateRelocExpr(const MCExpr *Expr,
     StringSwitch<EpiphanyMCExpr::EpiphanyExprKind>(RelocStr)
     .Case("high", EpiphanyMCExpr::CEK_HIGH)
     .Case("low",  EpiphanyMCExpr::CEK_LOW)
+    .Case("gprel", EpiphanyMCExpr::CEK_GPREL)
     .Default(EpiphanyMCExpr::CEK_None);
 
   assert(Kind != EpiphanyMCExpr::CEK_None);
@@ -41,8 +41,13 @@ namespace EpiphanyCC {
 namespace llvm {
   class EpiphanyTargetMachine;
   class FunctionPass;
+  class ModulePass;
 
+  ModulePass *createEpiphanyArithModePass();
   FunctionPass *createEpiphanyFpuConfigPass();
+  FunctionPass *createEpiphanyHardwareLoopsPass();
+  FunctionPass *createEpiphanyInstrCompressionPass();
+  FunctionPass *createEpiphanyLoadStoreOptimizerPass();
 
 } // end namespace llvm;
 
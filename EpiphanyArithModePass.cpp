@@ -0,0 +1,114 @@
+//===---------------------EpiphanyArithModePass.cpp -----------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass prepares the internal functions to be entered in their mode.
+//
+//  If all the uses of a local function are direct calls, the function can
+//  be entered in the mode it needs. Such functions get the known callers
+//  attribute. The FPU config pass then classifies them by their selected
+//  instructions: a function using only one mode is compiled as already
+//  running in it, so it neither switches nor saves and restores CONFIG, and
+//  calls to it are treated as instructions requiring that mode. Callers
+//  running in the same mode don't switch either.
+//
+//  The mode is known to the callers only if the callee is compiled first,
+//  so the functions are reordered callees first. Callees still compiled
+//  after some of their callers (recursion) are entered in any mode.
+//
+
+#include "EpiphanyArithModePass.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "epiphany_arith_mode"
+
+static cl::opt<bool> DisableArithModeIPA("disable-epiphany-arith-mode-ipa",
+    cl::Hidden, cl::init(false), cl::desc("Disable Epiphany interprocedural arithmetic mode"));
+
+const char *EpiphanyArithModePass::KnownCallersAttr = "epiphany-known-callers";
+
+char EpiphanyArithModePass::ID = 0;
+
+// Add the callees of F and then F itself to Order
+static void visitCallees(Function &F, SmallPtrSetImpl<Function *> &Visited,
+    std::vector<Function *> &Order) {
+  if (!Visited.insert(&F).second) {
+    return;
+  }
+  for (Instruction &I : instructions(F)) {
+    CallSite CS(&I);
+    if (!CS) {
+      continue;
+    }
+    Function *Callee = CS.getCalledFunction();
+    if (Callee && !Callee->isDeclaration()) {
+      visitCallees(*Callee, Visited, Order);
+    }
+  }
+  Order.push_back(&F);
+}
+
+// Check that the function is called directly only
+bool EpiphanyArithModePass::hasKnownCallers(const Function &F) const {
+  if (F.isDeclaration() || !F.hasLocalLinkage() || F.use_empty()) {
+    return false;
+  }
+  // Interrupt handlers are entered in any mode
+  if (F.hasFnAttribute("interrupt")) {
+    return false;
+  }
+  for (const Use &U : F.uses()) {
+    ImmutableCallSite CS(U.getUser());
+    if (!CS || !CS.isCallee(&U)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EpiphanyArithModePass::runOnModule(Module &M) {
+  if (DisableArithModeIPA || skipModule(M)) {
+    return false;
+  }
+
+  DEBUG(dbgs() << "\nRunning Epiphany arithmetic mode pass\n");
+  bool Changed = false;
+  for (Function &F : M) {
+    if (!hasKnownCallers(F)) {
+      continue;
+    }
+    DEBUG(dbgs() << F.getName() << " has known callers\n");
+    F.addFnAttr(KnownCallersAttr);
+    Changed = true;
+  }
+  if (!Changed) {
+    return false;
+  }
+
+  // Code is generated in the module order
+  SmallPtrSet<Function *, 32> Visited;
+  std::vector<Function *> Order;
+  for (Function &F : M) {
+    if (!F.isDeclaration()) {
+      visitCallees(F, Visited, Order);
+    }
+  }
+  for (Function *F : Order) {
+    F->removeFromParent();
+    M.getFunctionList().push_back(F);
+  }
+
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+//                         Public Constructor Functions
+//===----------------------------------------------------------------------===//
+ModulePass *llvm::createEpiphanyArithModePass() {
+  return new EpiphanyArithModePass();
+}
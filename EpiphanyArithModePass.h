@@ -0,0 +1,46 @@
+//===---------------------EpiphanyArithModePass.h---------------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYARITHMODEPASS_H
+#define _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYARITHMODEPASS_H
+
+#include "Epiphany.h"
+#include "EpiphanyConfig.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+namespace llvm {
+
+  class EpiphanyArithModePass : public ModulePass {
+
+    private:
+      bool hasKnownCallers(const Function &F) const;
+
+    public:
+      // Function attribute of the functions called directly only
+      static const char *KnownCallersAttr;
+
+      static char ID;
+      EpiphanyArithModePass() : ModulePass(ID) {}
+
+      StringRef getPassName() const {
+        return "Epiphany interprocedural arithmetic mode pass";
+      }
+      bool runOnModule(Module &M);
+  };
+
+} // namespace llvm
+
+#endif
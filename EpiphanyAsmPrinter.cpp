@@ -20,6 +20,7 @@
 #include "Epiphany.h"
 #include "EpiphanyInstrInfo.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
@@ -31,9 +32,12 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCExpr.h"
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
@@ -43,8 +47,14 @@ using namespace llvm;
 
 #define DEBUG_TYPE "asm-printer"
 
+static cl::opt<bool> DualIssueComments("epiphany-dual-issue-comments",
+    cl::Hidden, cl::init(false), cl::desc("Report Epiphany instruction pairs that can be dual issued"));
+
+STATISTIC(NumDualIssued, "Number of instruction pairs that can be dual issued");
+
 bool EpiphanyAsmPrinter::runOnMachineFunction(MachineFunction &MF) {
   EpiphanyFI = MF.getInfo<EpiphanyMachineFunctionInfo>();
+  FuncDualIssued = 0;
   AsmPrinter::runOnMachineFunction(MF);
   return true;
 }
@@ -60,6 +70,60 @@ void EpiphanyAsmPrinter::EmitInstruction(const MachineInstr *MI) {
     return;
   }
   
+  // Dual issue is only tracked within the block
+  if (MI == &MI->getParent()->front()) {
+    HasPrevInst = false;
+  }
+
+  // Hardware loop end. LE points to the last instruction of the loop, which
+  // has to be double word aligned, so it is labeled right before it is
+  // emitted after the padding. The loop start is aligned by its block
+  // alignment, the padding goes before the loop. Only an empty body gets a
+  // nop to point to.
+  if (MI->getOpcode() == Epiphany::LOOPEND) {
+    if (!getLoopEnd(MI->getParent())) {
+      HasPrevInst = false;
+      OutStreamer->EmitCodeAlignment(8);
+      OutStreamer->EmitLabel(MI->getOperand(1).getMCSymbol());
+      MCInst Nop;
+      Nop.setOpcode(Epiphany::NOP);
+      OutStreamer->EmitInstruction(Nop, getSubtargetInfo());
+    }
+    return;
+  }
+  if (const MachineInstr *LoopEnd = getLoopEnd(MI->getParent())) {
+    MachineBasicBlock::const_iterator Next = std::next(MachineBasicBlock::const_iterator(MI));
+    MachineBasicBlock::const_iterator End = MI->getParent()->end();
+    while (Next != End && Next->isDebugValue()) {
+      ++Next;
+    }
+    if (Next != End && &*Next == LoopEnd) {
+      HasPrevInst = false;
+      OutStreamer->EmitCodeAlignment(8);
+      OutStreamer->EmitLabel(LoopEnd->getOperand(1).getMCSymbol());
+    }
+  }
+
+  // DMA wait, expanded this late to keep it a single instruction for the
+  // schedulers
+  if (MI->getOpcode() == Epiphany::DMAWAIT) {
+    HasPrevInst = false;
+    emitDMAWait(MI);
+    return;
+  }
+
+  // Arithmetic mode switches, expanded this late as GIE is a terminator
+  if (MI->getOpcode() == Epiphany::CONFIGMODE) {
+    HasPrevInst = false;
+    emitConfigMode(MI);
+    return;
+  }
+  if (MI->getOpcode() == Epiphany::CONFIGRESTORE) {
+    HasPrevInst = false;
+    emitConfigRestore(MI);
+    return;
+  }
+
   //@print out instruction:
   //  Print out both ordinary instruction and boudle instruction
   MachineBasicBlock::const_instr_iterator I = MI->getIterator();
@@ -71,11 +135,221 @@ void EpiphanyAsmPrinter::EmitInstruction(const MachineInstr *MI) {
   
     MCInst TmpInst;
     MCInstLowering.Lower(&*I, TmpInst);
+    if (DualIssueComments) {
+      if (HasPrevInst && canDualIssue(PrevInst, TmpInst)) {
+        ++NumDualIssued;
+        ++FuncDualIssued;
+        if (isVerbose()) {
+          OutStreamer->AddComment("dual issue");
+        }
+        // The pair is complete, next instruction starts a new cycle
+        HasPrevInst = false;
+      } else {
+        PrevInst = TmpInst;
+        HasPrevInst = true;
+      }
+    }
     OutStreamer->EmitInstruction(TmpInst, getSubtargetInfo());
   } while ((++I != E) && I->isInsideBundle());
 }
 //@EmitInstruction }
 
+// Get LOOPEND of the hardware loop body, if it has other instructions
+const MachineInstr *EpiphanyAsmPrinter::getLoopEnd(const MachineBasicBlock *MBB) const {
+  MachineBasicBlock::const_iterator Term = MBB->getFirstTerminator();
+  if (Term == MBB->end() || Term->getOpcode() != Epiphany::LOOPEND) {
+    return nullptr;
+  }
+  for (MachineBasicBlock::const_iterator I = MBB->begin(); I != Term; ++I) {
+    if (!I->isDebugValue()) {
+      return &*Term;
+    }
+  }
+  return nullptr;
+}
+
+// Poll DMAxSTATUS until the channel state in its lower 4 bits gets idle:
+//   1: movfs tmp, DMAxSTATUS
+//      lsl   tmp, tmp, #28
+//      bne   1b
+void EpiphanyAsmPrinter::emitDMAWait(const MachineInstr *MI) {
+  unsigned Tmp = MI->getOperand(0).getReg();
+  unsigned Status = MI->getOperand(1).getImm() ? Epiphany::DMA1STATUS : Epiphany::DMA0STATUS;
+
+  MCSymbol *Loop = OutContext.createTempSymbol();
+  OutStreamer->EmitLabel(Loop);
+
+  MCInst MovFS;
+  MovFS.setOpcode(Epiphany::MOVFSDMA32rr);
+  MovFS.addOperand(MCOperand::createReg(Tmp));
+  MovFS.addOperand(MCOperand::createReg(Status));
+  OutStreamer->EmitInstruction(MovFS, getSubtargetInfo());
+
+  MCInst Shift;
+  Shift.setOpcode(Epiphany::LSL32ri);
+  Shift.addOperand(MCOperand::createReg(Tmp));
+  Shift.addOperand(MCOperand::createReg(Tmp));
+  Shift.addOperand(MCOperand::createImm(28));
+  OutStreamer->EmitInstruction(Shift, getSubtargetInfo());
+
+  MCInst Branch;
+  Branch.setOpcode(Epiphany::BCC32);
+  Branch.addOperand(MCOperand::createExpr(MCSymbolRefExpr::create(Loop, OutContext)));
+  Branch.addOperand(MCOperand::createImm(EpiphanyCC::COND_NE));
+  Branch.addOperand(MCOperand::createReg(Tmp));
+  OutStreamer->EmitInstruction(Branch, getSubtargetInfo());
+}
+
+void EpiphanyAsmPrinter::emitInst(unsigned Opcode, ArrayRef<MCOperand> Operands) {
+  MCInst Inst;
+  Inst.setOpcode(Opcode);
+  for (const MCOperand &Op : Operands) {
+    Inst.addOperand(Op);
+  }
+  OutStreamer->EmitInstruction(Inst, getSubtargetInfo());
+}
+
+// Save the interrupt state and disable interrupts:
+//   movfs state, status
+//   gid
+void EpiphanyAsmPrinter::emitIntDisable(unsigned State) {
+  emitInst(Epiphany::MOVFS32rr, {MCOperand::createReg(State),
+      MCOperand::createReg(Epiphany::STATUS)});
+  emitInst(Epiphany::GID, {});
+}
+
+// Enable interrupts only if they were enabled when saved, as the switch may
+// be in a GID region or an interrupt handler. STATUS[1] is the GID bit:
+//   lsr   state, state, #1
+//   lsl   state, state, #31
+//   bne   1f
+//   gie
+// 1:
+void EpiphanyAsmPrinter::emitIntRestore(unsigned State) {
+  MCOperand Reg = MCOperand::createReg(State);
+  emitInst(Epiphany::LSR32ri, {Reg, Reg, MCOperand::createImm(1)});
+  emitInst(Epiphany::LSL32ri, {Reg, Reg, MCOperand::createImm(31)});
+
+  MCSymbol *Skip = OutContext.createTempSymbol();
+  emitInst(Epiphany::BCC32, {MCOperand::createExpr(MCSymbolRefExpr::create(Skip, OutContext)),
+      MCOperand::createImm(EpiphanyCC::COND_NE), Reg});
+  emitInst(Epiphany::GIE, {});
+  OutStreamer->EmitLabel(Skip);
+}
+
+// Replace CONFIG[19:17] with the mode with interrupts disabled:
+//   movfs state, status
+//   gid
+//   movfs tmp, config
+//   mov   mask, #0xffff
+//   movt  mask, #0xfff1
+//   and   tmp, tmp, mask
+//   mov   mask, #0            ; only for a non-zero mode
+//   movt  mask, #(mode << 1)
+//   orr   tmp, tmp, mask
+//   movts config, tmp
+//   ...                       ; gie if interrupts were enabled
+void EpiphanyAsmPrinter::emitConfigMode(const MachineInstr *MI) {
+  MCOperand Tmp = MCOperand::createReg(MI->getOperand(0).getReg());
+  MCOperand Mask = MCOperand::createReg(MI->getOperand(1).getReg());
+  unsigned State = MI->getOperand(2).getReg();
+  MCOperand Config = MCOperand::createReg(Epiphany::CONFIG);
+  unsigned Mode = MI->getOperand(3).getImm();
+
+  emitIntDisable(State);
+  emitInst(Epiphany::MOVFS32rr, {Tmp, Config});
+  emitInst(Epiphany::MOVi32ri, {Mask, MCOperand::createImm(0xffff)});
+  emitInst(Epiphany::MOVTi32ri, {Mask, Mask, MCOperand::createImm(0xfff1)});
+  emitInst(Epiphany::ANDrr_r32, {Tmp, Tmp, Mask});
+  if (Mode) {
+    emitInst(Epiphany::MOVi32ri, {Mask, MCOperand::createImm(0)});
+    emitInst(Epiphany::MOVTi32ri, {Mask, Mask, MCOperand::createImm(Mode << 1)});
+    emitInst(Epiphany::ORRrr_r32, {Tmp, Tmp, Mask});
+  }
+  emitInst(Epiphany::MOVTS32rr, {Config, Tmp});
+  emitIntRestore(State);
+}
+
+// Put back the saved CONFIG with interrupts disabled
+void EpiphanyAsmPrinter::emitConfigRestore(const MachineInstr *MI) {
+  unsigned State = MI->getOperand(0).getReg();
+  emitIntDisable(State);
+  emitInst(Epiphany::MOVTS32rr, {MCOperand::createReg(Epiphany::CONFIG),
+      MCOperand::createReg(MI->getOperand(1).getReg())});
+  emitIntRestore(State);
+}
+
+// Get the issue slot of the instruction from its scheduling class
+enum IssueSlot { IS_None, IS_Int, IS_Fpu };
+static IssueSlot getIssueSlot(const MCInstrDesc &Desc) {
+  switch (Desc.getSchedClass()) {
+    default:
+      return IS_None;
+    case Epiphany::Sched::IaluItin:
+    case Epiphany::Sched::LoadItin:
+    case Epiphany::Sched::StoreItin:
+    case Epiphany::Sched::ControlItin:
+    case Epiphany::Sched::BranchItin:
+      return IS_Int;
+    case Epiphany::Sched::FpuItin:
+    case Epiphany::Sched::Ialu2Itin:
+      return IS_Fpu;
+  }
+}
+
+// The E16 issues an integer or load/store instruction together with an FPU
+// instruction, if the second one doesn't touch registers written by the first
+bool EpiphanyAsmPrinter::canDualIssue(const MCInst &First,
+    const MCInst &Second) const {
+  const EpiphanyInstrInfo *TII = Subtarget->getInstrInfo();
+  const EpiphanyRegisterInfo *TRI = Subtarget->getRegisterInfo();
+  const MCInstrDesc &FirstDesc = TII->get(First.getOpcode());
+  const MCInstrDesc &SecondDesc = TII->get(Second.getOpcode());
+
+  IssueSlot FirstSlot = getIssueSlot(FirstDesc);
+  IssueSlot SecondSlot = getIssueSlot(SecondDesc);
+  if (FirstSlot == IS_None || SecondSlot == IS_None || FirstSlot == SecondSlot) {
+    return false;
+  }
+
+  SmallVector<unsigned, 4> Defs;
+  for (unsigned i = 0, e = FirstDesc.getNumDefs(); i != e; ++i) {
+    if (First.getOperand(i).isReg()) {
+      Defs.push_back(First.getOperand(i).getReg());
+    }
+  }
+  for (unsigned i = 0, e = FirstDesc.getNumImplicitDefs(); i != e; ++i) {
+    Defs.push_back(FirstDesc.getImplicitDefs()[i]);
+  }
+
+  auto isDefined = [&](unsigned Reg) {
+    for (unsigned Def : Defs) {
+      if (TRI->regsOverlap(Def, Reg)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  for (unsigned i = 0, e = Second.getNumOperands(); i != e; ++i) {
+    const MCOperand &MO = Second.getOperand(i);
+    if (MO.isReg() && MO.getReg() && isDefined(MO.getReg())) {
+      return false;
+    }
+  }
+  for (unsigned i = 0, e = SecondDesc.getNumImplicitUses(); i != e; ++i) {
+    if (isDefined(SecondDesc.getImplicitUses()[i])) {
+      return false;
+    }
+  }
+  for (unsigned i = 0, e = SecondDesc.getNumImplicitDefs(); i != e; ++i) {
+    if (isDefined(SecondDesc.getImplicitDefs()[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 //===----------------------------------------------------------------------===//
 //
 //  Epiphany Asm Directives
@@ -218,6 +492,13 @@ void EpiphanyAsmPrinter::EmitFunctionBodyStart() {
 /// EmitFunctionBodyEnd - Targets can override this to emit stuff after
 /// the last basic block in the function.
 void EpiphanyAsmPrinter::EmitFunctionBodyEnd() {
+  // Statistics are compiled out of the release builds, so the count goes
+  // to the assembly too
+  if (DualIssueComments && isVerbose()) {
+    OutStreamer->emitRawComment(" " + Twine(FuncDualIssued) +
+        " instruction pairs can be dual issued");
+  }
+
   // There are instruction for this macros, but they must
   // always be at the function end, and we can't emit and
   // break with BB logic.
@@ -21,6 +21,7 @@
 #include "EpiphanyMCInstLower.h"
 #include "EpiphanySubtarget.h"
 #include "EpiphanyTargetMachine.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/Support/Compiler.h"
@@ -40,6 +41,22 @@ class LLVM_LIBRARY_VISIBILITY EpiphanyAsmPrinter : public AsmPrinter {
 private:
   bool lowerOperand(const MachineOperand &MO, MCOperand &MCOp);
 
+  // Previously emitted instruction of the block, for dual issue comments
+  MCInst PrevInst;
+  bool HasPrevInst;
+  // Number of dual issued pairs in the function
+  unsigned FuncDualIssued;
+
+  bool canDualIssue(const MCInst &First, const MCInst &Second) const;
+
+  const MachineInstr *getLoopEnd(const MachineBasicBlock *MBB) const;
+  void emitDMAWait(const MachineInstr *MI);
+  void emitIntDisable(unsigned State);
+  void emitIntRestore(unsigned State);
+  void emitConfigMode(const MachineInstr *MI);
+  void emitConfigRestore(const MachineInstr *MI);
+  void emitInst(unsigned Opcode, ArrayRef<MCOperand> Operands);
+
 public:
 
   const EpiphanySubtarget *Subtarget;
@@ -48,7 +65,8 @@ public:
 
   explicit EpiphanyAsmPrinter(TargetMachine &TM, 
                               std::unique_ptr<MCStreamer> Streamer)
-    : AsmPrinter(TM, std::move(Streamer)), 
+    : AsmPrinter(TM, std::move(Streamer)), HasPrevInst(false),
+      FuncDualIssued(0),
       MCInstLowering(*this) {
     Subtarget = static_cast<EpiphanyTargetMachine &>(TM).getSubtargetImpl();
   }
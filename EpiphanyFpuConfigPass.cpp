@@ -8,12 +8,32 @@
 //
 // This pass adds correct FPU/IALU2 flags to CONFIG register.
 //
-//  Run through all instruction of the first block and its successors, find
-//  first FPU instruction in each branch, set config flag on the top-level MBB and restore it
-//  at the end.
+//  FPU instructions need CONFIG[19:17] = 000 and IALU2 ones need 100. The
+//  mode required by each block is propagated over the CFG starting with the
+//  caller's mode on entry, and switches are inserted only where the incoming
+//  mode differs from the required one. If all the predecessors that are in
+//  a different mode fall through to the block only, the switch is placed at
+//  their ends instead, so that loops don't switch on every iteration.
+//
+//  Mode instructions implicitly use CONFIG and the switches define it, so
+//  the later passes keep them in order. The switches are pseudos expanded
+//  by the AsmPrinter into GID, MOVFS/MOVTS and GIE. GIE is skipped if the
+//  interrupts were already disabled, so the switch can be done in GID
+//  regions and interrupt handlers. The switches clobber the flags, which is
+//  fine as they are placed before flag setting mode instructions, calls, or
+//  terminators that don't read the flags.
+//
+//  Original CONFIG is saved on entry and restored before returns only if
+//  the mode might be changed on that return path.
+//
+//  Internal functions with known callers (see EpiphanyArithModePass) that
+//  use a single mode are entered and left in that mode, if none of their
+//  callers is compiled yet. Calls to them then require that mode.
 //
 
 #include "EpiphanyFpuConfigPass.h"
+#include "EpiphanyArithModePass.h"
+#include "llvm/ADT/PostOrderIterator.h"
 
 using namespace llvm;
 
@@ -22,105 +42,256 @@ using namespace llvm;
 
 char EpiphanyFpuConfigPass::ID = 0;
 
+bool EpiphanyFpuConfigPass::doInitialization(Module &M) {
+  FunctionModes.clear();
+  Compiled.clear();
+  return false;
+}
+
+// Get mode the function is entered in, if known
+EpiphanyFpuConfigPass::ArithMode EpiphanyFpuConfigPass::getFunctionMode(const Function *F) const {
+  auto It = FunctionModes.find(F);
+  return (It != FunctionModes.end()) ? It->second : MODE_NONE;
+}
+
+// Function can be entered in its mode if all of its callers are compiled
+// after it, and so can switch to that mode before the call
+bool EpiphanyFpuConfigPass::canEnterInMode(const Function &F) const {
+  if (!F.hasFnAttribute(EpiphanyArithModePass::KnownCallersAttr)) {
+    return false;
+  }
+  for (const User *U : F.users()) {
+    const Instruction *Call = dyn_cast<Instruction>(U);
+    if (!Call) {
+      return false;
+    }
+    const Function *Caller = Call->getParent()->getParent();
+    if (Caller != &F && Compiled.count(Caller)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Get arithmetic mode required by the instruction
+EpiphanyFpuConfigPass::ArithMode EpiphanyFpuConfigPass::getInstrMode(const MachineInstr &MI) const {
+  // Callee with known mode should be entered in it
+  if (MI.isCall()) {
+    const MachineOperand &Callee = MI.getOperand(0);
+    if (Callee.isGlobal()) {
+      return getFunctionMode(dyn_cast<Function>(Callee.getGlobal()));
+    }
+    return MODE_NONE;
+  }
+
+  switch (MI.getOpcode()) {
+    case Epiphany::FADDrr_r16:
+    case Epiphany::FADDrr_r32:
+    case Epiphany::FSUBrr_r16:
+    case Epiphany::FSUBrr_r32:
+    case Epiphany::FMULrr_r16:
+    case Epiphany::FMULrr_r32:
+    case Epiphany::FMADDrr_r16:
+    case Epiphany::FMADDrr_r32:
+    case Epiphany::FMSUBrr_r16:
+    case Epiphany::FMSUBrr_r32:
+    case Epiphany::FLOAT32rr:
+    case Epiphany::FIX32rr:
+      return MODE_FPU;
+    case Epiphany::IADDrr_r16:
+    case Epiphany::IADDrr_r32:
+    case Epiphany::ISUBrr_r16:
+    case Epiphany::ISUBrr_r32:
+    case Epiphany::IMULrr_r16:
+    case Epiphany::IMULrr_r32:
+    case Epiphany::IMADDrr_r16:
+    case Epiphany::IMADDrr_r32:
+    case Epiphany::IMSUBrr_r16:
+    case Epiphany::IMSUBrr_r32:
+      return MODE_IALU2;
+    default:
+      return MODE_NONE;
+  }
+}
+
+// Mode on the join of two paths
+EpiphanyFpuConfigPass::ArithMode EpiphanyFpuConfigPass::meetModes(ArithMode A, ArithMode B) {
+  if (A == MODE_NONE) {
+    return B;
+  }
+  if (B == MODE_NONE || A == B) {
+    return A;
+  }
+  return MODE_CONFLICT;
+}
+
+// Step 1: Find first and last required mode of each block
+void EpiphanyFpuConfigPass::computeBlockModes(MachineFunction &MF) {
+  Blocks.clear();
+  Blocks.resize(MF.getNumBlockIDs());
+  BodyMode = MODE_NONE;
+  for (MachineBasicBlock &MBB : MF) {
+    BlockInfo &BI = Blocks[MBB.getNumber()];
+    for (MachineInstr &MI : MBB) {
+      ArithMode Mode = getInstrMode(MI);
+      if (Mode == MODE_NONE) {
+        continue;
+      }
+      BodyMode = meetModes(BodyMode, Mode);
+      if (BI.First == MODE_NONE) {
+        BI.First = Mode;
+      }
+      BI.Last = Mode;
+    }
+  }
+}
+
+// Step 2: Propagate modes over the CFG until nothing changes
+void EpiphanyFpuConfigPass::propagateModes(MachineFunction &MF, ArithMode EntryMode) {
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&MF);
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (MachineBasicBlock *MBB : RPOT) {
+      BlockInfo &BI = Blocks[MBB->getNumber()];
+      ArithMode In = (MBB == &MF.front()) ? EntryMode : MODE_NONE;
+      for (MachineBasicBlock *Pred : MBB->predecessors()) {
+        In = meetModes(In, Blocks[Pred->getNumber()].Out);
+      }
+      ArithMode Out = (BI.Last != MODE_NONE) ? BI.Last : In;
+      if (In != BI.In || Out != BI.Out) {
+        BI.In  = In;
+        BI.Out = Out;
+        Changed = true;
+      }
+    }
+  }
+}
+
+// Switch can be placed at the block end if it falls to a single successor
+// and flags are not used by the branch
+bool EpiphanyFpuConfigPass::canSwitchAtExit(const MachineBasicBlock &MBB) const {
+  if (MBB.succ_size() != 1) {
+    return false;
+  }
+  for (const MachineInstr &MI : MBB.terminators()) {
+    if (MI.readsRegister(Epiphany::STATUS)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Set CONFIG[19:17] to the given mode, 000 for FPU and 100 for IALU2
+void EpiphanyFpuConfigPass::insertModeSwitch(MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I, ArithMode Mode) const {
+  DebugLoc DL = (I != MBB.end()) ? I->getDebugLoc() : DebugLoc();
+  const TargetRegisterClass *RC = &Epiphany::GPR32RegClass;
+
+  // Scratch registers for the config value, the mask and the interrupt state
+  unsigned configTmpReg = MRI->createVirtualRegister(RC);
+  unsigned maskTmpReg = MRI->createVirtualRegister(RC);
+  unsigned stateTmpReg = MRI->createVirtualRegister(RC);
+  BuildMI(MBB, I, DL, TII->get(Epiphany::CONFIGMODE), configTmpReg)
+    .addReg(maskTmpReg, RegState::Define)
+    .addReg(stateTmpReg, RegState::Define)
+    .addImm(Mode == MODE_IALU2 ? 0x4 : 0x0);
+}
+
+// Put back CONFIG saved on entry
+void EpiphanyFpuConfigPass::insertModeRestore(MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I, unsigned SavedReg) const {
+  DebugLoc DL = (I != MBB.end()) ? I->getDebugLoc() : DebugLoc();
+  unsigned stateTmpReg = MRI->createVirtualRegister(&Epiphany::GPR32RegClass);
+  BuildMI(MBB, I, DL, TII->get(Epiphany::CONFIGRESTORE), stateTmpReg).addReg(SavedReg);
+}
+
 bool EpiphanyFpuConfigPass::runOnMachineFunction(MachineFunction &MF) {
   DEBUG(dbgs() << "\nRunning Epiphany FPU config pass\n");
   auto &ST = MF.getSubtarget<EpiphanySubtarget>();
-  const EpiphanyInstrInfo *TII = ST.getInstrInfo();
-  MachineFrameInfo &MFI = MF.getFrameInfo();
-  MachineRegisterInfo &MRI = MF.getRegInfo();
-  const TargetRegisterClass *RC = &Epiphany::GPR32RegClass;
+  TII = ST.getInstrInfo();
+  MRI = &MF.getRegInfo();
+  const Function *F = MF.getFunction();
+  Compiled.insert(F);
+
+  computeBlockModes(MF);
+  // Nothing to do if FPU/IALU2 is not used at all
+  if (BodyMode == MODE_NONE) {
+    return false;
+  }
+  // Callers of the internal functions using a single mode switch to it
+  ArithMode EntryMode = MODE_ENTRY;
+  if (BodyMode != MODE_CONFLICT && canEnterInMode(*F)) {
+    DEBUG(dbgs() << F->getName() << " is entered in "
+        << (BodyMode == MODE_FPU ? "fpu" : "ialu2") << " mode\n");
+    EntryMode = BodyMode;
+    FunctionModes[F] = BodyMode;
+    // Recursive calls require the mode now
+    computeBlockModes(MF);
+  }
+  propagateModes(MF, EntryMode);
 
-  // FPU opcodes
-  unsigned opcodesFPU[] = {Epiphany::FADDrr_r16, Epiphany::FADDrr_r32, Epiphany::FSUBrr_r16, Epiphany::FSUBrr_r32,
-    Epiphany::FMULrr_r16, Epiphany::FMULrr_r32, Epiphany::FMADDrr_r16, Epiphany::FMADDrr_r32,
-    Epiphany::FMSUBrr_r16, Epiphany::FMSUBrr_r32};
-
-  // Prepare binary flag and regs
-  bool hasFPU;
-  unsigned frameIdx;
-
-  // Step 1: Loop over all of the basic blocks to find the first FPU instruction
-  for(MachineFunction::iterator it = MF.begin(), E = MF.end(); it != E; ++it) {
-    MachineBasicBlock *MBB = &*it;
-    // Loop over all instructions search for FPU instructions
-    for(MachineBasicBlock::iterator MBBI = MBB->begin(), MBBE = MBB->end(); MBBI != MBBE; ++MBBI) {
-      MachineInstr *MI = &*MBBI;
-      // Check if the opcode used is one of the FPU opcodesFPU
-      bool isFPU = std::find(std::begin(opcodesFPU), std::end(opcodesFPU), MI->getOpcode()) != std::end(opcodesFPU);
-      // If FPU inst found - break and insert config
-      if (isFPU) {
-        hasFPU = true;
-        break;
+  // Step 3: Decide where to switch on the block entries
+  for (MachineBasicBlock &MBB : MF) {
+    BlockInfo &BI = Blocks[MBB.getNumber()];
+    if (BI.First == MODE_NONE || BI.In == BI.First) {
+      continue;
+    }
+    bool AtPreds = (BI.In == MODE_CONFLICT);
+    for (MachineBasicBlock *Pred : MBB.predecessors()) {
+      if (Blocks[Pred->getNumber()].Out != BI.First && !canSwitchAtExit(*Pred)) {
+        AtPreds = false;
       }
     }
-    // Break if the first instruction was already found
-    if (hasFPU) {
-      break;
+    if (!AtPreds) {
+      continue;
+    }
+    for (MachineBasicBlock *Pred : MBB.predecessors()) {
+      BlockInfo &PI = Blocks[Pred->getNumber()];
+      if (PI.Out != BI.First) {
+        DEBUG(dbgs() << "Switching mode at the end of BB#" << Pred->getNumber() << "\n");
+        PI.Exit = BI.First;
+      }
     }
+    BI.In = BI.First;
   }
 
-  // Step 2: Insert config
-  if (hasFPU) {
-    // Create and insert new basic block for the config reg switch
-    MachineBasicBlock *Front = &MF.front();
-    MachineBasicBlock *MBB = MF.CreateMachineBasicBlock();
-    MachineBasicBlock::iterator insertPos = MBB->begin();
-    DebugLoc DL = DebugLoc();
-    MF.insert(MF.begin(), MBB);
-    MBB->addSuccessor(Front);
-    // Add function live-ins so that they'll be defined in every path
-    for (MachineRegisterInfo::livein_iterator LB = MRI.livein_begin(), LE = MRI.livein_end(); LB != LE; ++LB) {
-      MBB->addLiveIn(LB->first);
-    }
-    // Disable interrupts
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::GID)).addReg(Epiphany::CONFIG, RegState::ImplicitDefine);
-    // Get current config and save it to stack
-    unsigned configTmpReg = MRI.createVirtualRegister(RC);
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::MOVFS32rr), configTmpReg).addReg(Epiphany::CONFIG, RegState::Kill);
-    frameIdx = MFI.CreateStackObject(RC->getSize(), /* Alignment = */ RC->getSize(), /* isSS = */ false);
-    TII->storeRegToStackSlot(*MBB, insertPos, configTmpReg, /* killReg = */ false, frameIdx, RC, ST.getRegisterInfo());
-    // Create mask with bits 19:17 set to 0
-    unsigned lowTmpReg = MRI.createVirtualRegister(RC);
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::MOVi32ri), lowTmpReg).addImm(0xffff);
-    unsigned tmpReg = MRI.createVirtualRegister(RC);
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::MOVTi32ri), tmpReg).addReg(lowTmpReg).addImm(0xfff1);
-    // Apply mask to configTmpReg
-    unsigned maskReg = MRI.createVirtualRegister(RC);
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::ANDrr_r32), maskReg).addReg(configTmpReg, RegState::Kill).addReg(tmpReg, RegState::Kill);
-    // Push reg back to config
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::MOVTS32rr), Epiphany::CONFIG).addReg(maskReg, RegState::Kill);
-    // Restore interrupts
-    BuildMI(*MBB, insertPos, DL, TII->get(Epiphany::GIE)).addReg(Epiphany::CONFIG, RegState::ImplicitKill);
-  }
-
-
-  // Step 3 - find the last FPU instruction of the last block and insert flag reset 
-  if (hasFPU) {
-    MachineBasicBlock *MBB = &MF.back();
-    MachineBasicBlock::iterator MBBI = MBB->end();
-    MBBI--;
-    for (MachineBasicBlock::iterator MBBE = MBB->begin(); MBBI != MBBE; --MBBI) {
-      MachineInstr *MI = &*MBBI;
-      if (MI->isTerminator()) {
-        break;
+  // Step 4: Insert switches where the mode changes
+  for (MachineBasicBlock &MBB : MF) {
+    BlockInfo &BI = Blocks[MBB.getNumber()];
+    ArithMode Mode = BI.In;
+    for (MachineBasicBlock::iterator I = MBB.begin(), E = MBB.end(); I != E; ++I) {
+      ArithMode Required = getInstrMode(*I);
+      if (Required != MODE_NONE && Required != Mode) {
+        DEBUG(dbgs() << "Switching mode in BB#" << MBB.getNumber() << " before "; I->print(dbgs()));
+        insertModeSwitch(MBB, I, Required);
+        Mode = Required;
       }
-      // Check if the opcode used is one of the FPU opcodesFPU
-      //bool isFPU = std::find(std::begin(opcodesFPU), std::end(opcodesFPU), MI->getOpcode()) != std::end(opcodesFPU);
-      // If FPU inst found - insert config flag
-      //if (isFPU) {
-      //break;
-      //}
+      // Keep calls to the functions entered in a known mode after the switch
+      if (Required != MODE_NONE && I->isCall()) {
+        I->addOperand(MF, MachineOperand::CreateReg(Epiphany::CONFIG, false, true));
+      }
+    }
+    if (BI.Exit != MODE_NONE) {
+      insertModeSwitch(MBB, MBB.getFirstTerminator(), BI.Exit);
+    }
+  }
+
+  // Step 5: Restore caller's mode on returns where it might be changed
+  SmallVector<MachineBasicBlock *, 4> Returns;
+  for (MachineBasicBlock &MBB : MF) {
+    if (MBB.isReturnBlock() && Blocks[MBB.getNumber()].Out != EntryMode) {
+      Returns.push_back(&MBB);
+    }
+  }
+  if (!Returns.empty()) {
+    // Reading config doesn't need interrupts to be disabled
+    MachineBasicBlock &Entry = MF.front();
+    unsigned savedReg = MRI->createVirtualRegister(&Epiphany::GPR32RegClass);
+    BuildMI(Entry, Entry.begin(), DebugLoc(), TII->get(Epiphany::MOVFS32rr), savedReg).addReg(Epiphany::CONFIG);
+    for (MachineBasicBlock *MBB : Returns) {
+      insertModeRestore(*MBB, MBB->getFirstTerminator(), savedReg);
     }
-    DebugLoc DL = DebugLoc();
-    unsigned configTmpReg = MRI.createVirtualRegister(RC);
-    // Reload old config value 
-    TII->loadRegFromStackSlot(*MBB, MBBI, configTmpReg, frameIdx, RC, ST.getRegisterInfo());
-    // Disable interrupts
-    BuildMI(*MBB, MBBI, DL, TII->get(Epiphany::GID));
-    // Upload config value to the core
-    BuildMI(*MBB, MBBI, DL, TII->get(Epiphany::MOVTS32rr), Epiphany::CONFIG).addReg(configTmpReg, RegState::Kill);
-    // Restore interrupts
-    BuildMI(*MBB, MBBI, DL, TII->get(Epiphany::GIE)).addReg(Epiphany::CONFIG, RegState::ImplicitKill);
   }
 
   return true;
@@ -133,4 +304,3 @@ FunctionPass *llvm::createEpiphanyFpuConfigPass() {
   return new EpiphanyFpuConfigPass();
 }
 
-
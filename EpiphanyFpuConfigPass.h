@@ -14,6 +14,9 @@
 #include "EpiphanyMachineFunction.h"
 #include "EpiphanySubtarget.h"
 #include "EpiphanyTargetMachine.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
@@ -31,7 +34,50 @@ namespace llvm {
 
   class EpiphanyFpuConfigPass : public MachineFunctionPass {
 
+    public:
+      // Arithmetic mode selected by CONFIG[19:17]
+      enum ArithMode {
+        MODE_NONE = 0, // No requirement, or not computed yet
+        MODE_FPU,      // Floating point
+        MODE_IALU2,    // Signed integer
+        MODE_ENTRY,    // Mode of the caller
+        MODE_CONFLICT  // Different modes on incoming paths
+      };
+
     private:
+      // Per block mode info, indexed by block number
+      struct BlockInfo {
+        ArithMode First; // Mode required by the first mode instruction
+        ArithMode Last;  // Mode required by the last mode instruction
+        ArithMode In;    // Mode on the block entry
+        ArithMode Out;   // Mode on the block exit
+        ArithMode Exit;  // Mode to switch to at the block end
+        BlockInfo() : First(MODE_NONE), Last(MODE_NONE), In(MODE_NONE),
+          Out(MODE_NONE), Exit(MODE_NONE) {}
+      };
+      SmallVector<BlockInfo, 16> Blocks;
+      // Mode of all the mode instructions of the function
+      ArithMode BodyMode;
+
+      // Modes of the functions entered in their mode, and the functions
+      // compiled so far, kept over the module
+      DenseMap<const Function *, ArithMode> FunctionModes;
+      SmallPtrSet<const Function *, 32> Compiled;
+
+      const EpiphanyInstrInfo *TII;
+      MachineRegisterInfo *MRI;
+
+      ArithMode getFunctionMode(const Function *F) const;
+      bool canEnterInMode(const Function &F) const;
+      ArithMode getInstrMode(const MachineInstr &MI) const;
+      static ArithMode meetModes(ArithMode A, ArithMode B);
+      void computeBlockModes(MachineFunction &MF);
+      void propagateModes(MachineFunction &MF, ArithMode EntryMode);
+      bool canSwitchAtExit(const MachineBasicBlock &MBB) const;
+      void insertModeSwitch(MachineBasicBlock &MBB, MachineBasicBlock::iterator I,
+          ArithMode Mode) const;
+      void insertModeRestore(MachineBasicBlock &MBB, MachineBasicBlock::iterator I,
+          unsigned SavedReg) const;
 
     public:
       static char ID;
@@ -40,6 +86,7 @@ namespace llvm {
       StringRef getPassName() const {
         return "Epiphany FPU/IALU2 config flag optimization pass";
       }
+      bool doInitialization(Module &M) override;
       bool runOnMachineFunction(MachineFunction &MF);
   };
 
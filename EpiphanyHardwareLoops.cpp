@@ -0,0 +1,503 @@
+//===---------------------EpiphanyHardwareLoops.cpp -----------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass converts countable innermost loops to E16 hardware loops.
+//
+//  Only single block loops are handled, closed by a conditional branch on an
+//  induction variable with constant step. The preheader loads LS and LE with
+//  the loop start and end addresses and LC with the trip count, and the
+//  compare and branch are replaced by LOOPEND pseudo. The loop start block
+//  is aligned to double word, and the AsmPrinter puts the loop end label on
+//  the last instruction of the body, aligned to double word as well.
+//
+//  Loops containing calls, interrupt control or special register moves are
+//  left untouched, as well as loops of interrupt handlers, as those would
+//  clobber loop registers of the interrupted code.
+//
+
+#include "EpiphanyHardwareLoops.h"
+#include "MCTargetDesc/EpiphanyBaseInfo.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "epiphany_hwloops"
+
+static cl::opt<bool> DisableHardwareLoops("disable-epiphany-hwloops",
+    cl::Hidden, cl::init(false), cl::desc("Disable Epiphany hardware loops"));
+
+char EpiphanyHardwareLoops::ID = 0;
+
+// Get step of the induction variable update, i.e. add Rd, Rn, #step
+static bool getStep(const MachineInstr *MI, int64_t &Step) {
+  int64_t Sign;
+  switch (MI->getOpcode()) {
+    case Epiphany::ADD16ri:
+    case Epiphany::ADD32ri:
+      Sign = 1;
+      break;
+    case Epiphany::SUB16ri:
+    case Epiphany::SUB32ri:
+      Sign = -1;
+      break;
+    default:
+      return false;
+  }
+  if (!MI->getOperand(1).isReg() || !MI->getOperand(2).isImm()) {
+    return false;
+  }
+  Step = Sign * MI->getOperand(2).getImm();
+  return Step != 0;
+}
+
+// Get condition code for the swapped compare operands
+static EpiphanyCC::CondCodes swapCondition(EpiphanyCC::CondCodes CC) {
+  switch (CC) {
+    default:
+      return CC;
+    case EpiphanyCC::COND_GTU:
+      return EpiphanyCC::COND_LTU;
+    case EpiphanyCC::COND_GTEU:
+      return EpiphanyCC::COND_LTEU;
+    case EpiphanyCC::COND_LTEU:
+      return EpiphanyCC::COND_GTEU;
+    case EpiphanyCC::COND_LTU:
+      return EpiphanyCC::COND_GTU;
+    case EpiphanyCC::COND_GT:
+      return EpiphanyCC::COND_LT;
+    case EpiphanyCC::COND_GTE:
+      return EpiphanyCC::COND_LTE;
+    case EpiphanyCC::COND_LT:
+      return EpiphanyCC::COND_GT;
+    case EpiphanyCC::COND_LTE:
+      return EpiphanyCC::COND_GTE;
+  }
+}
+
+void EpiphanyHardwareLoops::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<MachineLoopInfo>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+bool EpiphanyHardwareLoops::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableHardwareLoops || skipFunction(*MF.getFunction())) {
+    return false;
+  }
+  // Interrupt handlers can't touch loop registers
+  if (MF.getFunction()->hasFnAttribute("interrupt")) {
+    return false;
+  }
+
+  DEBUG(dbgs() << "\nRunning Epiphany hardware loops pass\n");
+  TII = MF.getSubtarget<EpiphanySubtarget>().getInstrInfo();
+  MRI = &MF.getRegInfo();
+  MachineLoopInfo &MLI = getAnalysis<MachineLoopInfo>();
+
+  // Hardware loops can't be nested, so only innermost loops are converted
+  bool Changed = false;
+  SmallVector<MachineLoop *, 8> Worklist(MLI.begin(), MLI.end());
+  while (!Worklist.empty()) {
+    MachineLoop *L = Worklist.pop_back_val();
+    if (!L->empty()) {
+      Worklist.append(L->begin(), L->end());
+      continue;
+    }
+    Changed |= convertToHardwareLoop(L);
+  }
+
+  return Changed;
+}
+
+// Check that loop body doesn't contain anything that may use loop registers
+// or change control flow
+bool EpiphanyHardwareLoops::isSafeLoopBody(MachineBasicBlock *MBB) const {
+  for (MachineInstr &MI : *MBB) {
+    if (MI.isCall() || MI.isReturn() || MI.isInlineAsm()) {
+      return false;
+    }
+    switch (MI.getOpcode()) {
+      case Epiphany::GID:
+      case Epiphany::GIE:
+      case Epiphany::IDLE:
+      case Epiphany::MOVFS32rr:
+      case Epiphany::MOVTS32rr:
+      case Epiphany::CONFIGMODE:
+      case Epiphany::CONFIGRESTORE:
+      case Epiphany::DMAWAIT:
+      case Epiphany::LOOPEND:
+        return false;
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+// Get constant value of the register defined by mov/movt
+bool EpiphanyHardwareLoops::getConstant(unsigned Reg, int64_t &Val) const {
+  if (!TargetRegisterInfo::isVirtualRegister(Reg)) {
+    return false;
+  }
+  MachineInstr *Def = MRI->getVRegDef(Reg);
+  if (!Def) {
+    return false;
+  }
+
+  switch (Def->getOpcode()) {
+    default:
+      return false;
+    case TargetOpcode::COPY:
+      return getConstant(Def->getOperand(1).getReg(), Val);
+    case Epiphany::MOVi16ri:
+      if (!Def->getOperand(1).isImm()) {
+        return false;
+      }
+      Val = Def->getOperand(1).getImm() & 0xff;
+      return true;
+    case Epiphany::MOVi32ri:
+      if (!Def->getOperand(1).isImm()) {
+        return false;
+      }
+      Val = Def->getOperand(1).getImm() & 0xffff;
+      return true;
+    case Epiphany::MOVTi32ri: {
+      int64_t Low;
+      if (!Def->getOperand(2).isImm() || !getConstant(Def->getOperand(1).getReg(), Low)) {
+        return false;
+      }
+      Val = SignExtend64<32>((Low & 0xffff) | ((Def->getOperand(2).getImm() & 0xffff) << 16));
+      return true;
+    }
+  }
+}
+
+// Check if the register is an induction variable of the loop, either the
+// header PHI itself or its update on the backedge. Returns initial value
+// register and step of the variable.
+bool EpiphanyHardwareLoops::getInductionVar(MachineLoop *L, unsigned Reg,
+    unsigned &InitReg, int64_t &Step, bool &IsNext) const {
+  if (!TargetRegisterInfo::isVirtualRegister(Reg)) {
+    return false;
+  }
+  MachineInstr *Def = MRI->getVRegDef(Reg);
+  if (!Def) {
+    return false;
+  }
+
+  // Find the PHI
+  MachineInstr *Phi = Def;
+  IsNext = !Def->isPHI();
+  if (IsNext) {
+    if (!getStep(Def, Step) || !TargetRegisterInfo::isVirtualRegister(Def->getOperand(1).getReg())) {
+      return false;
+    }
+    Phi = MRI->getVRegDef(Def->getOperand(1).getReg());
+  }
+  if (!Phi || !Phi->isPHI() || Phi->getParent() != L->getHeader() || Phi->getNumOperands() != 5) {
+    return false;
+  }
+
+  // PHI operands are (Rd, Val0, MBB0, Val1, MBB1)
+  unsigned UpdateReg = 0;
+  InitReg = 0;
+  for (unsigned i = 1; i < Phi->getNumOperands(); i += 2) {
+    if (L->contains(Phi->getOperand(i + 1).getMBB())) {
+      UpdateReg = Phi->getOperand(i).getReg();
+    } else {
+      InitReg = Phi->getOperand(i).getReg();
+    }
+  }
+  if (!UpdateReg || !InitReg) {
+    return false;
+  }
+
+  // Check that the value coming from the backedge is the PHI update
+  MachineInstr *Update = MRI->getVRegDef(UpdateReg);
+  if (!Update || !getStep(Update, Step) ||
+      Update->getOperand(1).getReg() != Phi->getOperand(0).getReg()) {
+    return false;
+  }
+  return !IsNext || Update == Def;
+}
+
+// Build the constant in the virtual register
+unsigned EpiphanyHardwareLoops::materializeImm(MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I, int64_t Val) const {
+  DebugLoc DL = (I != MBB.end()) ? I->getDebugLoc() : DebugLoc();
+  const TargetRegisterClass *RC = &Epiphany::GPR32RegClass;
+
+  unsigned Reg = MRI->createVirtualRegister(RC);
+  BuildMI(MBB, I, DL, TII->get(Epiphany::MOVi32ri), Reg).addImm(Val & 0xffff);
+  if ((Val & 0xffffffff) >> 16) {
+    unsigned HiReg = MRI->createVirtualRegister(RC);
+    BuildMI(MBB, I, DL, TII->get(Epiphany::MOVTi32ri), HiReg).addReg(Reg, RegState::Kill).addImm((Val >> 16) & 0xffff);
+    Reg = HiReg;
+  }
+  return Reg;
+}
+
+// Compute trip count of the loop and put it to the register at the end of
+// the preheader. Returns 0 if the loop is not countable.
+unsigned EpiphanyHardwareLoops::getTripCount(MachineLoop *L, MachineInstr *Cmp,
+    EpiphanyCC::CondCodes CC) {
+  MachineBasicBlock *Preheader = L->getLoopPreheader();
+  MachineBasicBlock::iterator InsertPos = Preheader->getFirstTerminator();
+  DebugLoc DL = (InsertPos != Preheader->end()) ? InsertPos->getDebugLoc() : DebugLoc();
+
+  // Get compared values, cmp is made with sub
+  unsigned LHS, RHS = 0;
+  int64_t Bound = 0;
+  bool BoundIsImm = false;
+  switch (Cmp->getOpcode()) {
+    default:
+      return 0;
+    case Epiphany::SUBrr_r16:
+    case Epiphany::SUBrr_r32:
+      LHS = Cmp->getOperand(1).getReg();
+      RHS = Cmp->getOperand(2).getReg();
+      break;
+    case Epiphany::SUB16ri:
+    case Epiphany::SUB32ri:
+      if (!Cmp->getOperand(2).isImm()) {
+        return 0;
+      }
+      LHS = Cmp->getOperand(1).getReg();
+      Bound = Cmp->getOperand(2).getImm();
+      BoundIsImm = true;
+      break;
+  }
+
+  // Induction variable should be on the left side, swap otherwise
+  unsigned InitReg;
+  int64_t Step;
+  bool IsNext;
+  if (!getInductionVar(L, LHS, InitReg, Step, IsNext)) {
+    if (BoundIsImm || !getInductionVar(L, RHS, InitReg, Step, IsNext)) {
+      return 0;
+    }
+    std::swap(LHS, RHS);
+    CC = swapCondition(CC);
+  }
+
+  // Bound should be loop invariant
+  if (!BoundIsImm) {
+    BoundIsImm = getConstant(RHS, Bound);
+  }
+  if (!BoundIsImm) {
+    MachineInstr *BoundDef = TargetRegisterInfo::isVirtualRegister(RHS) ? MRI->getVRegDef(RHS) : nullptr;
+    if (!BoundDef || L->contains(BoundDef->getParent())) {
+      return 0;
+    }
+  }
+
+  bool IsUnsigned;
+  switch (CC) {
+    default:
+      return 0;
+    case EpiphanyCC::COND_NE:
+    case EpiphanyCC::COND_GT:
+    case EpiphanyCC::COND_GTE:
+    case EpiphanyCC::COND_LT:
+    case EpiphanyCC::COND_LTE:
+      IsUnsigned = false;
+      break;
+    case EpiphanyCC::COND_GTU:
+    case EpiphanyCC::COND_GTEU:
+    case EpiphanyCC::COND_LTU:
+    case EpiphanyCC::COND_LTEU:
+      IsUnsigned = true;
+      break;
+  }
+
+  int64_t Init;
+  if (BoundIsImm && getConstant(InitReg, Init)) {
+    // Both ends are known, count iterations at compile time
+    int64_t Min = IsUnsigned ? 0 : INT32_MIN;
+    int64_t Max = IsUnsigned ? UINT32_MAX : INT32_MAX;
+    Init  = IsUnsigned ? (Init  & 0xffffffff) : SignExtend64<32>(Init);
+    Bound = IsUnsigned ? (Bound & 0xffffffff) : SignExtend64<32>(Bound);
+    // First value compared
+    int64_t Start = IsNext ? Init + Step : Init;
+    // Number of backedges taken
+    int64_t Taken;
+    switch (CC) {
+      default:
+        return 0;
+      case EpiphanyCC::COND_NE:
+        if ((Bound - Start) % Step) {
+          return 0;
+        }
+        Taken = (Bound - Start) / Step;
+        if (Taken < 0) {
+          return 0;
+        }
+        break;
+      case EpiphanyCC::COND_LT:
+      case EpiphanyCC::COND_LTU:
+        Taken = (Bound - Start + Step - 1) / Step;
+        break;
+      case EpiphanyCC::COND_LTE:
+      case EpiphanyCC::COND_LTEU:
+        Taken = (Bound - Start + Step) / Step;
+        break;
+      case EpiphanyCC::COND_GT:
+      case EpiphanyCC::COND_GTU:
+        Taken = (Start - Bound - Step - 1) / -Step;
+        break;
+      case EpiphanyCC::COND_GTE:
+      case EpiphanyCC::COND_GTEU:
+        Taken = (Start - Bound - Step) / -Step;
+        break;
+    }
+    // Check that the step goes towards the bound without wrapping
+    bool IsLess = (CC == EpiphanyCC::COND_LT || CC == EpiphanyCC::COND_LTU ||
+        CC == EpiphanyCC::COND_LTE || CC == EpiphanyCC::COND_LTEU);
+    bool IsGreater = (CC == EpiphanyCC::COND_GT || CC == EpiphanyCC::COND_GTU ||
+        CC == EpiphanyCC::COND_GTE || CC == EpiphanyCC::COND_GTEU);
+    if ((IsLess && Step < 0) || (IsGreater && Step > 0)) {
+      return 0;
+    }
+    Taken = std::max<int64_t>(Taken, 0);
+    int64_t Last = Start + Taken * Step;
+    if (Start < Min || Start > Max || Last < Min || Last > Max) {
+      return 0;
+    }
+    // Nothing to gain on a single iteration
+    int64_t Count = Taken + 1;
+    if (Count < 2 || Count > UINT32_MAX) {
+      return 0;
+    }
+    DEBUG(dbgs() << "Trip count " << Count << "\n");
+    return materializeImm(*Preheader, InsertPos, Count);
+  }
+
+  // Otherwise only unit step with NE condition is handled, as it can't
+  // miss the bound
+  if (CC != EpiphanyCC::COND_NE || (Step != 1 && Step != -1)) {
+    return 0;
+  }
+  DEBUG(dbgs() << "Run-time trip count\n");
+  if (BoundIsImm) {
+    RHS = materializeImm(*Preheader, InsertPos, Bound);
+  }
+  const TargetRegisterClass *RC = &Epiphany::GPR32RegClass;
+  unsigned CountReg = MRI->createVirtualRegister(RC);
+  if (Step == 1) {
+    BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::SUBrr_r32), CountReg).addReg(RHS).addReg(InitReg);
+  } else {
+    BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::SUBrr_r32), CountReg).addReg(InitReg).addReg(RHS);
+  }
+  // PHI is compared before the update, so one more iteration is made
+  if (!IsNext) {
+    unsigned IncReg = MRI->createVirtualRegister(RC);
+    BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::ADD32ri), IncReg).addReg(CountReg, RegState::Kill).addImm(1);
+    CountReg = IncReg;
+  }
+  return CountReg;
+}
+
+bool EpiphanyHardwareLoops::convertToHardwareLoop(MachineLoop *L) {
+  MachineBasicBlock *Header = L->getHeader();
+  MachineBasicBlock *Preheader = L->getLoopPreheader();
+
+  // Only single block loops are converted
+  if (!Preheader || L->getNumBlocks() != 1 || Header->succ_size() != 2 || !isSafeLoopBody(Header)) {
+    return false;
+  }
+  MachineBasicBlock *Exit = *Header->succ_begin();
+  if (Exit == Header) {
+    Exit = *std::next(Header->succ_begin());
+  }
+
+  // Get loop condition
+  MachineBasicBlock *TBB = nullptr, *FBB = nullptr;
+  SmallVector<MachineOperand, 1> Cond;
+  if (TII->analyzeBranch(*Header, TBB, FBB, Cond, false) || Cond.empty()) {
+    return false;
+  }
+  if (Cond[0].getImm() >= EpiphanyCC::COND_BEQ) {
+    return false;
+  }
+  if (TBB != Header) {
+    if (FBB != Header || TII->reverseBranchCondition(Cond)) {
+      return false;
+    }
+  }
+
+  // Find compare setting flags for the branch
+  MachineInstr *Branch = nullptr;
+  for (MachineInstr &MI : Header->terminators()) {
+    if (MI.getOpcode() == Epiphany::BCC32) {
+      Branch = &MI;
+    }
+  }
+  if (!Branch || !Branch->getOperand(2).isReg()) {
+    return false;
+  }
+  unsigned CmpReg = Branch->getOperand(2).getReg();
+  MachineInstr *Cmp = TargetRegisterInfo::isVirtualRegister(CmpReg) ? MRI->getVRegDef(CmpReg) : nullptr;
+  if (!Cmp || Cmp->getParent() != Header) {
+    return false;
+  }
+  for (MachineBasicBlock::iterator I = std::next(MachineBasicBlock::iterator(Cmp)), E(Branch); I != E; ++I) {
+    if (I->definesRegister(Epiphany::STATUS)) {
+      return false;
+    }
+  }
+
+  unsigned CountReg = getTripCount(L, Cmp, static_cast<EpiphanyCC::CondCodes>(Cond[0].getImm()));
+  if (!CountReg) {
+    return false;
+  }
+  DEBUG(dbgs() << "Converting BB#" << Header->getNumber() << " to hardware loop\n");
+
+  // Load loop start and end addresses and trip count
+  MachineFunction &MF = *Header->getParent();
+  MachineBasicBlock::iterator InsertPos = Preheader->getFirstTerminator();
+  DebugLoc DL = Branch->getDebugLoc();
+  const TargetRegisterClass *RC = &Epiphany::GPR32RegClass;
+  MCSymbol *EndSym = MF.getContext().createTempSymbol("loop_end", true);
+
+  unsigned StartLo = MRI->createVirtualRegister(RC);
+  unsigned StartHi = MRI->createVirtualRegister(RC);
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVi32ri), StartLo).addMBB(Header, EpiphanyII::MO_LOW);
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVTi32ri), StartHi).addReg(StartLo, RegState::Kill).addMBB(Header, EpiphanyII::MO_HIGH);
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVTS32rr), Epiphany::LS).addReg(StartHi, RegState::Kill);
+
+  unsigned EndLo = MRI->createVirtualRegister(RC);
+  unsigned EndHi = MRI->createVirtualRegister(RC);
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVi32ri), EndLo).addSym(EndSym, EpiphanyII::MO_LOW);
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVTi32ri), EndHi).addReg(EndLo, RegState::Kill).addSym(EndSym, EpiphanyII::MO_HIGH);
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVTS32rr), Epiphany::LE).addReg(EndHi, RegState::Kill);
+
+  BuildMI(*Preheader, InsertPos, DL, TII->get(Epiphany::MOVTS32rr), Epiphany::LC).addReg(CountReg, RegState::Kill);
+
+  // Replace compare and branch with the loop end marker
+  TII->removeBranch(*Header);
+  if (MRI->use_nodbg_empty(CmpReg)) {
+    Cmp->eraseFromParent();
+  }
+  BuildMI(Header, DL, TII->get(Epiphany::LOOPEND)).addMBB(Header).addSym(EndSym);
+  if (!Header->isLayoutSuccessor(Exit)) {
+    BuildMI(Header, DL, TII->get(Epiphany::BNONE32)).addMBB(Exit);
+  }
+  Header->addLiveIn(Epiphany::LC);
+  Header->addLiveIn(Epiphany::LS);
+  Header->addLiveIn(Epiphany::LE);
+
+  // Loop start should be aligned to double word
+  Header->setAlignment(3);
+
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+//                         Public Constructor Functions
+//===----------------------------------------------------------------------===//
+FunctionPass *llvm::createEpiphanyHardwareLoopsPass() {
+  return new EpiphanyHardwareLoops();
+}
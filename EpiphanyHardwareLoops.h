@@ -0,0 +1,61 @@
+//===---------------------EpiphanyHardwareLoops.h---------------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYHARDWARELOOPS_H
+#define _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYHARDWARELOOPS_H
+
+#include "Epiphany.h"
+#include "EpiphanyConfig.h"
+#include "EpiphanyMachineFunction.h"
+#include "EpiphanySubtarget.h"
+#include "EpiphanyTargetMachine.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+
+namespace llvm {
+
+  class EpiphanyHardwareLoops : public MachineFunctionPass {
+
+    private:
+      const EpiphanyInstrInfo *TII;
+      MachineRegisterInfo *MRI;
+
+      bool convertToHardwareLoop(MachineLoop *L);
+      bool isSafeLoopBody(MachineBasicBlock *MBB) const;
+      bool getConstant(unsigned Reg, int64_t &Val) const;
+      bool getInductionVar(MachineLoop *L, unsigned Reg, unsigned &InitReg,
+          int64_t &Step, bool &IsNext) const;
+      unsigned getTripCount(MachineLoop *L, MachineInstr *Cmp,
+          EpiphanyCC::CondCodes CC);
+      unsigned materializeImm(MachineBasicBlock &MBB,
+          MachineBasicBlock::iterator I, int64_t Val) const;
+
+    public:
+      static char ID;
+      EpiphanyHardwareLoops() : MachineFunctionPass(ID) {}
+
+      StringRef getPassName() const {
+        return "Epiphany hardware loops pass";
+      }
+      void getAnalysisUsage(AnalysisUsage &AU) const override;
+      bool runOnMachineFunction(MachineFunction &MF);
+  };
+
+} // namespace llvm
+
+#endif
@@ -18,6 +18,7 @@
 #include "MCTargetDesc/EpiphanyBaseInfo.h"
 #include "EpiphanyMachineFunction.h"
 #include "EpiphanyRegisterInfo.h"
+#include "EpiphanyTargetObjectFile.h"
 #include "EpiphanyTargetMachine.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
@@ -27,6 +28,7 @@
 #include "llvm/CodeGen/SelectionDAGISel.h"
 #include "llvm/CodeGen/SelectionDAGNodes.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
@@ -89,6 +91,11 @@ bool EpiphanyDAGToDAGISel::SelectAddr(SDNode *Parent, SDValue Addr, SDValue &Bas
   }
  
 
+  // Small data is addressed as SB + displacement, SB is out of GPR16 too
+  if (selectSmallDataAddr(Addr, Base, Offset)) {
+    return !is16bit;
+  }
+
   // if Address is FI, get the TargetFrameIndex.
   if (FrameIndexSDNode *FIN = dyn_cast<FrameIndexSDNode>(Addr)) {
     Base   = CurDAG->getTargetFrameIndex(FIN->getIndex(), ValTy);
@@ -117,6 +124,274 @@ bool EpiphanyDAGToDAGISel::SelectAddr(SDNode *Parent, SDValue Addr, SDValue &Bas
   return true;
 }
 
+// Match (movt (mov ga), ga) or core-local (mov ga), plus an optional constant,
+// of a global living in .sdata/.sbss
+bool EpiphanyDAGToDAGISel::selectSmallDataAddr(SDValue Addr, SDValue &Base, SDValue &Offset) {
+  EVT ValTy = Addr.getValueType();
+  SDLoc DL(Addr);
+
+  int64_t Disp = 0;
+  if (CurDAG->isBaseWithConstantOffset(Addr)) {
+    Disp = cast<ConstantSDNode>(Addr.getOperand(1))->getSExtValue();
+    Addr = Addr.getOperand(0);
+  }
+  SDValue Sym;
+  if (Addr.getOpcode() == EpiphanyISD::MOVT) {
+    Sym = Addr.getOperand(1);
+  } else if (Addr.getOpcode() == EpiphanyISD::MOV) {
+    Sym = Addr.getOperand(0);
+  } else {
+    return false;
+  }
+
+  GlobalAddressSDNode *GA = dyn_cast<GlobalAddressSDNode>(Sym);
+  if (!GA) {
+    return false;
+  }
+  const GlobalObject *GO = GA->getGlobal()->getBaseObject();
+  if (!GO) {
+    return false;
+  }
+  const EpiphanyTargetObjectFile *TLOF =
+    static_cast<const EpiphanyTargetObjectFile *>(TM.getObjFileLowering());
+  if (!TLOF->IsGlobalInSmallSection(GO, TM)) {
+    return false;
+  }
+
+  Base   = CurDAG->getRegister(Epiphany::SB, ValTy);
+  Offset = CurDAG->getTargetGlobalAddress(GA->getGlobal(), DL, ValTy,
+      GA->getOffset() + Disp, EpiphanyII::MO_GPREL);
+  return true;
+}
+
+// Register + register address for the indexed load/store forms
+bool EpiphanyDAGToDAGISel::SelectAddrRR(SDValue Addr, SDValue &Base, SDValue &Index, bool isSub) {
+  if (Addr.getOpcode() != (isSub ? ISD::SUB : ISD::ADD)) {
+    return false;
+  }
+  SDValue LHS = Addr.getOperand(0);
+  SDValue RHS = Addr.getOperand(1);
+
+  // Constant offsets are left to the displacement forms
+  if (isa<ConstantSDNode>(RHS) || isa<ConstantSDNode>(LHS)) {
+    return false;
+  }
+  // Frame index will be replaced with SP/FP + offset
+  if (isa<FrameIndexSDNode>(LHS) || isa<FrameIndexSDNode>(RHS)) {
+    return false;
+  }
+
+  Base  = LHS;
+  Index = RHS;
+  return true;
+}
+
+// Double word offset is scaled by 8 and should fit into simm11, fall back to
+// the plain base otherwise
+void EpiphanyDAGToDAGISel::selectDwordAddr(SDNode *Parent, SDValue Addr, SDValue &Base, SDValue &Offset) {
+  SelectAddr(Parent, Addr, Base, Offset, /* is16bit = */ false);
+  ConstantSDNode *CN = dyn_cast<ConstantSDNode>(Offset);
+  if (CN && (CN->getSExtValue() % 8 || !isInt<11>(CN->getSExtValue() / 8))) {
+    Base   = Addr;
+    Offset = CurDAG->getTargetConstant(0, SDLoc(Addr), Addr.getValueType());
+  }
+}
+
+// Build the register pair out of two i32 values
+SDValue EpiphanyDAGToDAGISel::createPairNode(SDValue Lo, SDValue Hi) {
+  SDLoc DL(Lo);
+  SDValue RegClass = CurDAG->getTargetConstant(Epiphany::GPR64RegClassID, DL, MVT::i32);
+  SDValue SubLo    = CurDAG->getTargetConstant(Epiphany::isub_lo, DL, MVT::i32);
+  SDValue SubHi    = CurDAG->getTargetConstant(Epiphany::isub_hi, DL, MVT::i32);
+  const SDValue Ops[] = {RegClass, Lo, SubLo, Hi, SubHi};
+  return SDValue(CurDAG->getMachineNode(TargetOpcode::REG_SEQUENCE, DL, MVT::Untyped, Ops), 0);
+}
+
+// LDRD (chain, ptr) -> (lo, hi, chain)
+bool EpiphanyDAGToDAGISel::selectLoadDword(SDNode *Node) {
+  SDLoc DL(Node);
+  SDValue Base, Offset;
+  selectDwordAddr(Node, Node->getOperand(1), Base, Offset);
+
+  SDValue Ops[] = {Base, Offset, Node->getOperand(0)};
+  MachineSDNode *Ld = CurDAG->getMachineNode(Epiphany::LDRi64_r32, DL, MVT::Untyped, MVT::Other, Ops);
+  MachineSDNode::mmo_iterator MemOp = MF->allocateMemRefsArray(1);
+  MemOp[0] = cast<MemSDNode>(Node)->getMemOperand();
+  Ld->setMemRefs(MemOp, MemOp + 1);
+
+  // Split the pair
+  SDValue Lo = CurDAG->getTargetExtractSubreg(Epiphany::isub_lo, DL, MVT::i32, SDValue(Ld, 0));
+  SDValue Hi = CurDAG->getTargetExtractSubreg(Epiphany::isub_hi, DL, MVT::i32, SDValue(Ld, 0));
+  ReplaceUses(SDValue(Node, 0), Lo);
+  ReplaceUses(SDValue(Node, 1), Hi);
+  ReplaceUses(SDValue(Node, 2), SDValue(Ld, 1));
+  CurDAG->RemoveDeadNode(Node);
+  return true;
+}
+
+// STRD (chain, lo, hi, ptr) -> chain
+bool EpiphanyDAGToDAGISel::selectStoreDword(SDNode *Node) {
+  SDLoc DL(Node);
+  SDValue Base, Offset;
+  selectDwordAddr(Node, Node->getOperand(3), Base, Offset);
+
+  SDValue Pair = createPairNode(Node->getOperand(1), Node->getOperand(2));
+  SDValue Ops[] = {Pair, Base, Offset, Node->getOperand(0)};
+  MachineSDNode *St = CurDAG->getMachineNode(Epiphany::STRi64_r32, DL, MVT::Other, Ops);
+  MachineSDNode::mmo_iterator MemOp = MF->allocateMemRefsArray(1);
+  MemOp[0] = cast<MemSDNode>(Node)->getMemOperand();
+  St->setMemRefs(MemOp, MemOp + 1);
+
+  ReplaceNode(Node, St);
+  return true;
+}
+
+// DMA wait has no result, but the polling loop needs a scratch register
+bool EpiphanyDAGToDAGISel::selectIntrinsicVoid(SDNode *Node) {
+  unsigned IntNo = cast<ConstantSDNode>(Node->getOperand(1))->getZExtValue();
+  if (IntNo != Intrinsic::epiphany_dma_start && IntNo != Intrinsic::epiphany_dma_wait) {
+    return false;
+  }
+
+  // Channel selects the DMA registers, so it can't be a variable
+  ConstantSDNode *Chan = dyn_cast<ConstantSDNode>(Node->getOperand(2));
+  if (!Chan || Chan->getZExtValue() > 1) {
+    CurDAG->getContext()->diagnose(DiagnosticInfoUnsupported(*MF->getFunction(),
+        "DMA channel should be constant 0 or 1", SDLoc(Node).getDebugLoc()));
+    ReplaceUses(SDValue(Node, 0), Node->getOperand(0));
+    CurDAG->RemoveDeadNode(Node);
+    return true;
+  }
+  // DMA start is matched by its pattern
+  if (IntNo == Intrinsic::epiphany_dma_start) {
+    return false;
+  }
+
+  SDLoc DL(Node);
+  SDValue Ops[] = {CurDAG->getTargetConstant(Chan->getZExtValue(), DL, MVT::i32),
+                   Node->getOperand(0)};
+  MachineSDNode *Wait = CurDAG->getMachineNode(Epiphany::DMAWAIT, DL, MVT::i32, MVT::Other, Ops);
+
+  ReplaceUses(SDValue(Node, 0), SDValue(Wait, 1));
+  CurDAG->RemoveDeadNode(Node);
+  return true;
+}
+
+// Get post-modify opcode: displacement, register add or register sub
+static unsigned getPostModifyOpcode(const unsigned Opcodes[3], bool IsImm, bool IsSub) {
+  return IsImm ? Opcodes[0] : (IsSub ? Opcodes[2] : Opcodes[1]);
+}
+
+static unsigned getIndexedLoadOpcode(const LoadSDNode *LD, bool IsImm, bool IsSub) {
+  static const unsigned LDRi8[]   = {Epiphany::LDRi8_pmd_r32,   Epiphany::LDRi8_pm_add_r32,   Epiphany::LDRi8_pm_sub_r32};
+  static const unsigned LDRi8u[]  = {Epiphany::LDRi8u_pmd_r32,  Epiphany::LDRi8u_pm_add_r32,  Epiphany::LDRi8u_pm_sub_r32};
+  static const unsigned LDRi8z[]  = {Epiphany::LDRi8z_pmd_r32,  Epiphany::LDRi8z_pm_add_r32,  Epiphany::LDRi8z_pm_sub_r32};
+  static const unsigned LDRi16[]  = {Epiphany::LDRi16_pmd_r32,  Epiphany::LDRi16_pm_add_r32,  Epiphany::LDRi16_pm_sub_r32};
+  static const unsigned LDRi16u[] = {Epiphany::LDRi16u_pmd_r32, Epiphany::LDRi16u_pm_add_r32, Epiphany::LDRi16u_pm_sub_r32};
+  static const unsigned LDRi16z[] = {Epiphany::LDRi16z_pmd_r32, Epiphany::LDRi16z_pm_add_r32, Epiphany::LDRi16z_pm_sub_r32};
+  static const unsigned LDRi32[]  = {Epiphany::LDRi32_pmd_r32,  Epiphany::LDRi32_pm_add_r32,  Epiphany::LDRi32_pm_sub_r32};
+
+  ISD::LoadExtType ExtType = LD->getExtensionType();
+  switch (LD->getMemoryVT().getSimpleVT().SimpleTy) {
+    case MVT::i8:
+      if (ExtType == ISD::SEXTLOAD)
+        return getPostModifyOpcode(LDRi8, IsImm, IsSub);
+      if (ExtType == ISD::ZEXTLOAD)
+        return getPostModifyOpcode(LDRi8z, IsImm, IsSub);
+      return getPostModifyOpcode(LDRi8u, IsImm, IsSub);
+    case MVT::i16:
+      if (ExtType == ISD::SEXTLOAD)
+        return getPostModifyOpcode(LDRi16, IsImm, IsSub);
+      if (ExtType == ISD::ZEXTLOAD)
+        return getPostModifyOpcode(LDRi16z, IsImm, IsSub);
+      return getPostModifyOpcode(LDRi16u, IsImm, IsSub);
+    case MVT::i32:
+      return getPostModifyOpcode(LDRi32, IsImm, IsSub);
+    default:
+      return 0;
+  }
+}
+
+static unsigned getIndexedStoreOpcode(const StoreSDNode *ST, bool IsImm, bool IsSub) {
+  static const unsigned STRi8[]  = {Epiphany::STRi8_pmd_r32,  Epiphany::STRi8_pm_add_r32,  Epiphany::STRi8_pm_sub_r32};
+  static const unsigned STRi16[] = {Epiphany::STRi16_pmd_r32, Epiphany::STRi16_pm_add_r32, Epiphany::STRi16_pm_sub_r32};
+  static const unsigned STRi32[] = {Epiphany::STRi32_pmd_r32, Epiphany::STRi32_pm_add_r32, Epiphany::STRi32_pm_sub_r32};
+
+  switch (ST->getMemoryVT().getSimpleVT().SimpleTy) {
+    case MVT::i8:
+      return getPostModifyOpcode(STRi8, IsImm, IsSub);
+    case MVT::i16:
+      return getPostModifyOpcode(STRi16, IsImm, IsSub);
+    case MVT::i32:
+      return getPostModifyOpcode(STRi32, IsImm, IsSub);
+    default:
+      return 0;
+  }
+}
+
+// Post-modify load: (chain, base, offset) -> (value, new base, chain)
+bool EpiphanyDAGToDAGISel::selectIndexedLoad(SDNode *Node) {
+  LoadSDNode *LD = cast<LoadSDNode>(Node);
+  ISD::MemIndexedMode AM = LD->getAddressingMode();
+  if (AM != ISD::POST_INC && AM != ISD::POST_DEC) {
+    return false;
+  }
+
+  SDLoc DL(Node);
+  bool IsSub = (AM == ISD::POST_DEC);
+  SDValue Offset = LD->getOffset();
+  ConstantSDNode *CN = dyn_cast<ConstantSDNode>(Offset);
+  if (CN) {
+    // Displacement form has the sign in the immediate
+    int64_t Imm = IsSub ? -CN->getSExtValue() : CN->getSExtValue();
+    Offset = CurDAG->getTargetConstant(Imm, DL, MVT::i32);
+  }
+  unsigned Opc = getIndexedLoadOpcode(LD, CN != nullptr, IsSub);
+  if (!Opc) {
+    return false;
+  }
+
+  SDValue Ops[] = {LD->getBasePtr(), Offset, LD->getChain()};
+  MachineSDNode *Ld = CurDAG->getMachineNode(Opc, DL, LD->getValueType(0), MVT::i32, MVT::Other, Ops);
+  MachineSDNode::mmo_iterator MemOp = MF->allocateMemRefsArray(1);
+  MemOp[0] = LD->getMemOperand();
+  Ld->setMemRefs(MemOp, MemOp + 1);
+
+  ReplaceNode(Node, Ld);
+  return true;
+}
+
+// Post-modify store: (chain, value, base, offset) -> (new base, chain)
+bool EpiphanyDAGToDAGISel::selectIndexedStore(SDNode *Node) {
+  StoreSDNode *ST = cast<StoreSDNode>(Node);
+  ISD::MemIndexedMode AM = ST->getAddressingMode();
+  if (AM != ISD::POST_INC && AM != ISD::POST_DEC) {
+    return false;
+  }
+
+  SDLoc DL(Node);
+  bool IsSub = (AM == ISD::POST_DEC);
+  SDValue Offset = ST->getOffset();
+  ConstantSDNode *CN = dyn_cast<ConstantSDNode>(Offset);
+  if (CN) {
+    int64_t Imm = IsSub ? -CN->getSExtValue() : CN->getSExtValue();
+    Offset = CurDAG->getTargetConstant(Imm, DL, MVT::i32);
+  }
+  unsigned Opc = getIndexedStoreOpcode(ST, CN != nullptr, IsSub);
+  if (!Opc) {
+    return false;
+  }
+
+  SDValue Ops[] = {ST->getValue(), ST->getBasePtr(), Offset, ST->getChain()};
+  MachineSDNode *St = CurDAG->getMachineNode(Opc, DL, MVT::i32, MVT::Other, Ops);
+  MachineSDNode::mmo_iterator MemOp = MF->allocateMemRefsArray(1);
+  MemOp[0] = ST->getMemOperand();
+  St->setMemRefs(MemOp, MemOp + 1);
+
+  ReplaceNode(Node, St);
+  return true;
+}
+
 //@selectNode
 bool EpiphanyDAGToDAGISel::trySelect(SDNode *Node) {
   unsigned Opcode = Node->getOpcode();
@@ -137,6 +412,19 @@ bool EpiphanyDAGToDAGISel::trySelect(SDNode *Node) {
   switch(Opcode) {
     default: break;
 
+    case EpiphanyISD::LDRD:
+      return selectLoadDword(Node);
+    case EpiphanyISD::STRD:
+      return selectStoreDword(Node);
+
+    // Unindexed loads and stores are matched by patterns
+    case ISD::LOAD:
+      return selectIndexedLoad(Node);
+    case ISD::STORE:
+      return selectIndexedStore(Node);
+
+    case ISD::INTRINSIC_VOID:
+      return selectIntrinsicVoid(Node);
   }
 
   return false;
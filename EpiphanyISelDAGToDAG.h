@@ -73,6 +73,24 @@ private:
     return SelectAddr(Parent, Addr, Base, Offset, is16bit);
   }
   bool SelectAddr(SDNode *Parent, SDValue N, SDValue &Base, SDValue &Offset, bool is16bit);
+  bool selectSmallDataAddr(SDValue Addr, SDValue &Base, SDValue &Offset);
+  template<bool isSub> bool SelectAddrRR(SDValue Addr, SDValue &Base, SDValue &Index) {
+    return SelectAddrRR(Addr, Base, Index, isSub);
+  }
+  bool SelectAddrRR(SDValue Addr, SDValue &Base, SDValue &Index, bool isSub);
+
+  // Double word load/store of the register pair
+  void selectDwordAddr(SDNode *Parent, SDValue Addr, SDValue &Base, SDValue &Offset);
+  SDValue createPairNode(SDValue Lo, SDValue Hi);
+  bool selectLoadDword(SDNode *Node);
+  bool selectStoreDword(SDNode *Node);
+
+  // Post-modify load/store
+  bool selectIndexedLoad(SDNode *Node);
+  bool selectIndexedStore(SDNode *Node);
+
+  // DMA channel intrinsics
+  bool selectIntrinsicVoid(SDNode *Node);
 
   // getImm - Return a target constant with the specified value.
   inline SDValue getImm(const SDNode *Node, unsigned Imm) {
@@ -25,6 +25,7 @@
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineJumpTableInfo.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/CodeGen/ValueTypes.h"
@@ -51,11 +52,38 @@ const char *EpiphanyTargetLowering::getTargetNodeName(unsigned Opcode) const {
     case EpiphanyISD::MOVT:           return "EpiphanyISD::MOVT";
     case EpiphanyISD::STORE:          return "EpiphanyISD::STORE";
     case EpiphanyISD::LOAD:           return "EpiphanyISD::LOAD";
+    case EpiphanyISD::FIX_RN:         return "EpiphanyISD::FIX_RN";
+    case EpiphanyISD::LDRD:           return "EpiphanyISD::LDRD";
+    case EpiphanyISD::STRD:           return "EpiphanyISD::STRD";
 
     default:                          return NULL;
   }
 }
 
+static cl::opt<bool> ShortCalls("epiphany-short-calls",
+    cl::Hidden, cl::init(false),
+    cl::desc("Call with the 24-bit BL instead of MOV/MOVT and JALR"));
+
+static cl::opt<unsigned> MulModeSwitchCost("epiphany-mul-mode-cost",
+    cl::Hidden, cl::init(2),
+    cl::desc("Number of IALU ops worth spending to avoid IALU2 multiplication"));
+
+// IMUL goes through the FPU pipeline, so it's replaced by as many dependent
+// IALU ops as fit in its latency, plus some for the CONFIG mode switch
+static unsigned getMulReplacementBudget(const EpiphanySubtarget &STI) {
+  const InstrItineraryData *Itins = STI.getInstrItineraryData();
+  const EpiphanyInstrInfo *TII = STI.getInstrInfo();
+  auto getLatency = [&](unsigned Opc) {
+    unsigned SchedClass = TII->get(Opc).getSchedClass();
+    int DefCycle = Itins->getOperandCycle(SchedClass, 0);
+    int UseCycle = Itins->getOperandCycle(SchedClass, 1);
+    return (DefCycle > UseCycle) ? unsigned(DefCycle - UseCycle) : 1U;
+  };
+  unsigned AluLatency = getLatency(Epiphany::ADDrr_r32);
+  unsigned MulLatency = getLatency(Epiphany::IMULrr_r32);
+  return (MulLatency + AluLatency - 1) / AluLatency + MulModeSwitchCost;
+}
+
 //@EpiphanyTargetLowering {
 EpiphanyTargetLowering::EpiphanyTargetLowering(const EpiphanyTargetMachine &TM,
     const EpiphanySubtarget &STI)
@@ -88,14 +116,61 @@ EpiphanyTargetLowering::EpiphanyTargetLowering(const EpiphanyTargetMachine &TM,
     setOperationAction(ISD::UREM,      MVT::i32,  Expand);
     setOperationAction(ISD::SDIVREM,   MVT::i32,  Expand);
     setOperationAction(ISD::UDIVREM,   MVT::i32,  Expand);
-    setOperationAction(ISD::MULHS,     MVT::i32,  Expand);
-    setOperationAction(ISD::MULHU,     MVT::i32,  Expand);
     setOperationAction(ISD::UMUL_LOHI, MVT::i32,  Expand);
     setOperationAction(ISD::SMUL_LOHI, MVT::i32,  Expand);
 
     // Custom operations, see below
     setOperationAction(ISD::GlobalAddress,  MVT::i32, Custom);
     setOperationAction(ISD::ExternalSymbol, MVT::i32, Custom);
+    setOperationAction(ISD::JumpTable,      MVT::i32, Custom);
+
+    // Jump tables are loaded by index and jumped to with jr
+    setOperationAction(ISD::BR_JT, MVT::Other, Expand);
+
+    // High part of the multiplication is built from 16-bit halves, this also
+    // enables magic number division by constant
+    setOperationAction(ISD::MULHS, MVT::i32, Custom);
+    setOperationAction(ISD::MULHU, MVT::i32, Custom);
+
+    // No divide or square root on FPU, those are refined from estimates
+    setOperationAction(ISD::FDIV,  MVT::f32, Custom);
+    setOperationAction(ISD::FSQRT, MVT::f32, Custom);
+
+    // f32 compares are done on FPU flags, which can't detect NaN, so the
+    // predicates true for NaN operands test the operand bits as well
+    for (ISD::CondCode CC : {ISD::SETO, ISD::SETUO, ISD::SETONE, ISD::SETUEQ,
+                             ISD::SETUNE, ISD::SETULT, ISD::SETULE,
+                             ISD::SETUGT, ISD::SETUGE}) {
+      setCondCodeAction(CC, MVT::f32, Custom);
+    }
+    setOperationAction(ISD::FMINNUM, MVT::f32, Custom);
+    setOperationAction(ISD::FMAXNUM, MVT::f32, Custom);
+
+    // Double word loads and stores, i64 is not legal so those are
+    // replaced with register pair accesses
+    setOperationAction(ISD::LOAD,  MVT::i64, Custom);
+    setOperationAction(ISD::STORE, MVT::i64, Custom);
+
+    // Post-modify loads and stores
+    for (MVT VT : {MVT::i8, MVT::i16, MVT::i32}) {
+      setIndexedLoadAction(ISD::POST_INC,  VT, Legal);
+      setIndexedLoadAction(ISD::POST_DEC,  VT, Legal);
+      setIndexedStoreAction(ISD::POST_INC, VT, Legal);
+      setIndexedStoreAction(ISD::POST_DEC, VT, Legal);
+    }
+
+    // Constant offsets from core-local globals are folded into the MOV
+    setTargetDAGCombine(ISD::ADD);
+
+    // Multiplication by constant is done with shifts and adds if it's cheaper
+    setTargetDAGCombine(ISD::MUL);
+    MaxMulOps = getMulReplacementBudget(STI);
+
+    // Division of small operands is done on FPU
+    setTargetDAGCombine(ISD::SDIV);
+    setTargetDAGCombine(ISD::UDIV);
+    setTargetDAGCombine(ISD::SREM);
+    setTargetDAGCombine(ISD::UREM);
   }
 
 SDValue EpiphanyTargetLowering::LowerOperation(SDValue Op,
@@ -106,10 +181,284 @@ SDValue EpiphanyTargetLowering::LowerOperation(SDValue Op,
       break;
     case ISD::ExternalSymbol:
       return LowerExternalSymbol(Op, DAG);
+    case ISD::JumpTable:
+      return LowerJumpTable(Op, DAG);
+    case ISD::STORE:
+      return LowerSTORE(Op, DAG);
+    case ISD::MULHS:
+    case ISD::MULHU:
+      return LowerMULH(Op, DAG);
+    case ISD::FDIV:
+      return LowerFDIV(Op, DAG);
+    case ISD::FSQRT:
+      return LowerFSQRT(Op, DAG);
+    case ISD::FMINNUM:
+    case ISD::FMAXNUM:
+      return LowerFMINMAX(Op, DAG);
+    case ISD::SETCC:
+    case ISD::SELECT_CC:
+    case ISD::BR_CC:
+      return LowerFCMP(Op, DAG);
+  }
+  return SDValue();
+}
+
+void EpiphanyTargetLowering::ReplaceNodeResults(SDNode *N,
+    SmallVectorImpl<SDValue> &Results, SelectionDAG &DAG) const {
+  SDLoc DL(N);
+  switch (N->getOpcode()) {
+    default:
+      llvm_unreachable("Don't know how to custom expand this!");
+    case ISD::LOAD: {
+      // Load i64 as a register pair, leave the rest to the default expansion
+      LoadSDNode *LD = cast<LoadSDNode>(N);
+      if (LD->isIndexed() || LD->getExtensionType() != ISD::NON_EXTLOAD || LD->getAlignment() < 8) {
+        return;
+      }
+      SDValue Ops[] = {LD->getChain(), LD->getBasePtr()};
+      SDValue Pair = DAG.getMemIntrinsicNode(EpiphanyISD::LDRD, DL,
+          DAG.getVTList(MVT::i32, MVT::i32, MVT::Other), Ops, MVT::i64, LD->getMemOperand());
+      Results.push_back(DAG.getNode(ISD::BUILD_PAIR, DL, MVT::i64, Pair.getValue(0), Pair.getValue(1)));
+      Results.push_back(Pair.getValue(2));
+      return;
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+//  DAG combines
+//===----------------------------------------------------------------------===//
+SDValue EpiphanyTargetLowering::PerformDAGCombine(SDNode *N,
+    DAGCombinerInfo &DCI) const {
+  switch (N->getOpcode()) {
+    default:
+      break;
+    case ISD::ADD:
+      return PerformADDCombine(N, DCI);
+    case ISD::MUL:
+      return PerformMULCombine(N, DCI);
+    case ISD::SDIV:
+    case ISD::UDIV:
+    case ISD::SREM:
+    case ISD::UREM:
+      return PerformDIVCombine(N, DCI);
   }
   return SDValue();
 }
 
+// Fold (add (mov ga), c) into (mov ga+c) when nothing else uses the MOV, the
+// relocation then carries the offset and the add goes away
+SDValue EpiphanyTargetLowering::PerformADDCombine(SDNode *N,
+    DAGCombinerInfo &DCI) const {
+  SDValue Mov = N->getOperand(0);
+  ConstantSDNode *C = dyn_cast<ConstantSDNode>(N->getOperand(1));
+  if (!C || Mov.getOpcode() != EpiphanyISD::MOV || !Mov.hasOneUse()) {
+    return SDValue();
+  }
+  GlobalAddressSDNode *GA = dyn_cast<GlobalAddressSDNode>(Mov.getOperand(0));
+  if (!GA) {
+    return SDValue();
+  }
+
+  SelectionDAG &DAG = DCI.DAG;
+  SDLoc DL(N);
+  EVT VT = N->getValueType(0);
+  SDValue Addr = DAG.getTargetGlobalAddress(GA->getGlobal(), DL, VT,
+      GA->getOffset() + C->getSExtValue(), GA->getTargetFlags());
+  return DAG.getNode(EpiphanyISD::MOV, DL, VT, Addr);
+}
+
+// Replace multiplication by constant with shifts and adds/subs, using the
+// canonical signed digit form of the constant:
+//   x * 640 = (x * 5) << 7 = ((x << 2) + x) << 7
+//   x * 7   = (x << 3) - x
+SDValue EpiphanyTargetLowering::PerformMULCombine(SDNode *N,
+    DAGCombinerInfo &DCI) const {
+  EVT VT = N->getValueType(0);
+  ConstantSDNode *C = dyn_cast<ConstantSDNode>(N->getOperand(1));
+  if (VT != MVT::i32 || !C) {
+    return SDValue();
+  }
+
+  // 0, 1, -1 and powers of two are handled by the generic combiner
+  int64_t Imm = C->getSExtValue();
+  bool Negate = (Imm < 0);
+  uint64_t Val = Negate ? -Imm : Imm;
+  if (Val <= 1 || isPowerOf2_64(Val)) {
+    return SDValue();
+  }
+
+  // Get non-adjacent form digits, from the lowest one
+  SmallVector<std::pair<unsigned, int>, 8> Digits;
+  for (unsigned Pos = 0; Val != 0; Val >>= 1, ++Pos) {
+    if (Val & 1) {
+      int Digit = 2 - int(Val & 3);
+      Digits.push_back(std::make_pair(Pos, Digit));
+      Val -= Digit;
+    }
+  }
+
+  // Each digit but the top one takes a shift and add, plus final shift and
+  // negation (mov + sub)
+  unsigned NumOps = 2 * (Digits.size() - 1);
+  NumOps += (Digits.front().first != 0) ? 1 : 0;
+  NumOps += Negate ? 2 : 0;
+  if (NumOps > MaxMulOps) {
+    return SDValue();
+  }
+
+  SelectionDAG &DAG = DCI.DAG;
+  SDLoc DL(N);
+  SDValue X = N->getOperand(0);
+  SDValue Res = X;
+  unsigned Prev = Digits.back().first;
+  for (int i = Digits.size() - 2; i >= 0; --i) {
+    unsigned Pos = Digits[i].first;
+    Res = DAG.getNode(ISD::SHL, DL, VT, Res, DAG.getConstant(Prev - Pos, DL, MVT::i32));
+    Res = DAG.getNode(Digits[i].second > 0 ? ISD::ADD : ISD::SUB, DL, VT, Res, X);
+    Prev = Pos;
+  }
+  if (Prev != 0) {
+    Res = DAG.getNode(ISD::SHL, DL, VT, Res, DAG.getConstant(Prev, DL, MVT::i32));
+  }
+  if (Negate) {
+    Res = DAG.getNode(ISD::SUB, DL, VT, DAG.getConstant(0, DL, VT), Res);
+  }
+  return Res;
+}
+
+// There are no reciprocal or reciprocal square root instructions, so the
+// seeds are taken from the exponent bits. Relative error is about 5% for the
+// reciprocal and 3.5% for the reciprocal square root.
+static SDValue getRecipSeed(SDValue D, SelectionDAG &DAG) {
+  SDLoc DL(D);
+  SDValue Bits = DAG.getNode(ISD::BITCAST, DL, MVT::i32, D);
+  SDValue X = DAG.getNode(ISD::SUB, DL, MVT::i32,
+      DAG.getConstant(0x7ef311c3, DL, MVT::i32), Bits);
+  return DAG.getNode(ISD::BITCAST, DL, MVT::f32, X);
+}
+
+static SDValue getRsqrtSeed(SDValue A, SelectionDAG &DAG) {
+  SDLoc DL(A);
+  SDValue Bits = DAG.getNode(ISD::BITCAST, DL, MVT::i32, A);
+  Bits = DAG.getNode(ISD::SRL, DL, MVT::i32, Bits, DAG.getConstant(1, DL, MVT::i32));
+  SDValue Y = DAG.getNode(ISD::SUB, DL, MVT::i32,
+      DAG.getConstant(0x5f3759df, DL, MVT::i32), Bits);
+  return DAG.getNode(ISD::BITCAST, DL, MVT::f32, Y);
+}
+
+// Newton-Raphson steps for the reciprocal, each doubles the number of correct
+// bits: x = x + x * (1 - d * x), selected as fmsub and fmadd
+static SDValue getReciprocal(SDValue D, unsigned Steps, SelectionDAG &DAG) {
+  SDLoc DL(D);
+  SDValue One = DAG.getConstantFP(1.0, DL, MVT::f32);
+  SDValue X = getRecipSeed(D, DAG);
+  for (unsigned i = 0; i < Steps; ++i) {
+    SDValue E = DAG.getNode(ISD::FSUB, DL, MVT::f32, One,
+        DAG.getNode(ISD::FMUL, DL, MVT::f32, D, X));
+    X = DAG.getNode(ISD::FADD, DL, MVT::f32, X,
+        DAG.getNode(ISD::FMUL, DL, MVT::f32, X, E));
+  }
+  return X;
+}
+
+SDValue EpiphanyTargetLowering::getRecipEstimate(SDValue Operand,
+    DAGCombinerInfo &DCI, unsigned &RefinementSteps) const {
+  TargetRecip Recips = DCI.DAG.getTarget().Options.Reciprocals;
+  if (Operand.getValueType() != MVT::f32 || !Recips.isEnabled("divf")) {
+    return SDValue();
+  }
+  RefinementSteps = Recips.getRefinementSteps("divf");
+  return getRecipSeed(Operand, DCI.DAG);
+}
+
+SDValue EpiphanyTargetLowering::getRsqrtEstimate(SDValue Operand,
+    DAGCombinerInfo &DCI, unsigned &RefinementSteps,
+    bool &UseOneConstNR) const {
+  TargetRecip Recips = DCI.DAG.getTarget().Options.Reciprocals;
+  if (Operand.getValueType() != MVT::f32 || !Recips.isEnabled("sqrtf")) {
+    return SDValue();
+  }
+  RefinementSteps = Recips.getRefinementSteps("sqrtf");
+  UseOneConstNR = true;
+  return getRsqrtSeed(Operand, DCI.DAG);
+}
+
+// Division by variable is done on FPU if both operands fit into 16 bits, as
+// then all values are exact in f32. FIX rounds to nearest with the default
+// RMODE, which is assumed here; code that sets RMODE to truncation gets wrong
+// quotients. The rounding is kept in FIX_RN, as FP_TO_SINT truncates when
+// folded. The quotient is shifted by a half towards zero, which keeps its
+// fractional part within [-0.5 + 0.5/b, 0.5 - 0.5/b] and the rounding gives
+// the truncated quotient for any reciprocal error below 2^-18:
+//   q = fix(float(2 * a + sign(a) * (1 - |b|)) * recip(float(2 * b)))
+//   r = fix(float(a) - float(q) * float(b))
+// Other divisions are left to the runtime library.
+SDValue EpiphanyTargetLowering::PerformDIVCombine(SDNode *N,
+    DAGCombinerInfo &DCI) const {
+  EVT VT = N->getValueType(0);
+  SDValue A = N->getOperand(0);
+  SDValue B = N->getOperand(1);
+  if (VT != MVT::i32 || isa<ConstantSDNode>(B)) {
+    return SDValue();
+  }
+
+  SelectionDAG &DAG = DCI.DAG;
+  unsigned Opc = N->getOpcode();
+  bool IsSigned = (Opc == ISD::SDIV || Opc == ISD::SREM);
+  if (IsSigned) {
+    if (DAG.ComputeNumSignBits(A) < 17 || DAG.ComputeNumSignBits(B) < 17) {
+      return SDValue();
+    }
+  } else {
+    APInt KnownZero, KnownOne;
+    DAG.computeKnownBits(A, KnownZero, KnownOne);
+    if (KnownZero.countLeadingOnes() < 16) {
+      return SDValue();
+    }
+    DAG.computeKnownBits(B, KnownZero, KnownOne);
+    if (KnownZero.countLeadingOnes() < 16) {
+      return SDValue();
+    }
+  }
+
+  SDLoc DL(N);
+  SDValue One = DAG.getConstant(1, DL, MVT::i32);
+  SDValue ThirtyOne = DAG.getConstant(31, DL, MVT::i32);
+  SDValue AbsB = B;
+  if (IsSigned) {
+    SDValue SignB = DAG.getNode(ISD::SRA, DL, MVT::i32, B, ThirtyOne);
+    AbsB = DAG.getNode(ISD::SUB, DL, MVT::i32,
+        DAG.getNode(ISD::XOR, DL, MVT::i32, B, SignB), SignB);
+  }
+  SDValue Bias = DAG.getNode(ISD::SUB, DL, MVT::i32, One, AbsB);
+  if (IsSigned) {
+    SDValue SignA = DAG.getNode(ISD::SRA, DL, MVT::i32, A, ThirtyOne);
+    Bias = DAG.getNode(ISD::SUB, DL, MVT::i32,
+        DAG.getNode(ISD::XOR, DL, MVT::i32, Bias, SignA), SignA);
+  }
+  SDValue A2 = DAG.getNode(ISD::SHL, DL, MVT::i32, A, One);
+  A2 = DAG.getNode(ISD::ADD, DL, MVT::i32, A2, Bias);
+  SDValue B2 = DAG.getNode(ISD::SHL, DL, MVT::i32, B, One);
+  SDValue FA2 = DAG.getNode(ISD::SINT_TO_FP, DL, MVT::f32, A2);
+  SDValue FB2 = DAG.getNode(ISD::SINT_TO_FP, DL, MVT::f32, B2);
+
+  SDValue FQ = DAG.getNode(ISD::FMUL, DL, MVT::f32, FA2, getReciprocal(FB2, 3, DAG));
+  SDValue Q = DAG.getNode(EpiphanyISD::FIX_RN, DL, MVT::i32, FQ);
+  if (Opc == ISD::SDIV || Opc == ISD::UDIV) {
+    return Q;
+  }
+
+  // Remainder is exact too, and keeps the whole sequence on FPU. It's an
+  // integer, so any rounding gives it.
+  SDValue FA = DAG.getNode(ISD::SINT_TO_FP, DL, MVT::f32, A);
+  SDValue FB = DAG.getNode(ISD::SINT_TO_FP, DL, MVT::f32, B);
+  SDValue FQB = DAG.getNode(ISD::FMUL, DL, MVT::f32,
+      DAG.getNode(ISD::SINT_TO_FP, DL, MVT::f32, Q), FB);
+  SDValue FR = DAG.getNode(ISD::FSUB, DL, MVT::f32, FA, FQB);
+  return DAG.getNode(ISD::FP_TO_SINT, DL, MVT::i32, FR);
+}
+
 //===----------------------------------------------------------------------===//
 //  Lower helper functions
 //===----------------------------------------------------------------------===//
@@ -117,6 +466,87 @@ bool EpiphanyTargetLowering::isOffsetFoldingLegal(const GlobalAddressSDNode *GA)
   return false;
 }
 
+// Loads and stores support base + simm11 scaled by the access size and
+// base +/- index, globals are materialized with mov/movt
+bool EpiphanyTargetLowering::isLegalAddressingMode(const DataLayout &DL,
+    const AddrMode &AM, Type *Ty, unsigned AS) const {
+  if (AM.BaseGV) {
+    return false;
+  }
+
+  uint64_t Size = (Ty && Ty->isSized()) ? DL.getTypeStoreSize(Ty) : 1;
+  if (Size != 1 && Size != 2 && Size != 4 && Size != 8) {
+    Size = 1;
+  }
+
+  switch (AM.Scale) {
+    case 0:
+      // r + imm, there's no absolute addressing
+      if (!AM.HasBaseReg) {
+        return false;
+      }
+      return AM.BaseOffs % Size == 0 && isInt<11>(AM.BaseOffs / Size);
+    case 1:
+      // r + r, or just r
+      return AM.BaseOffs == 0;
+    case 2:
+      // r + r written as 2*r
+      return !AM.HasBaseReg && AM.BaseOffs == 0;
+    default:
+      return false;
+  }
+}
+
+// Post-modify supports both register and immediate offsets, immediate is
+// scaled by the access size and should fit into simm11
+bool EpiphanyTargetLowering::getPostIndexedAddressParts(SDNode *N, SDNode *Op,
+    SDValue &Base, SDValue &Offset, ISD::MemIndexedMode &AM, SelectionDAG &DAG) const {
+  EVT VT;
+  SDValue Ptr;
+  unsigned Align;
+  if (LoadSDNode *LD = dyn_cast<LoadSDNode>(N)) {
+    VT    = LD->getMemoryVT();
+    Ptr   = LD->getBasePtr();
+    Align = LD->getAlignment();
+  } else if (StoreSDNode *ST = dyn_cast<StoreSDNode>(N)) {
+    VT    = ST->getMemoryVT();
+    Ptr   = ST->getBasePtr();
+    Align = ST->getAlignment();
+  } else {
+    return false;
+  }
+  if (VT != MVT::i8 && VT != MVT::i16 && VT != MVT::i32) {
+    return false;
+  }
+  // Unaligned accesses are not supported
+  unsigned Size = VT.getStoreSize();
+  if (Align < Size) {
+    return false;
+  }
+
+  bool IsSub = Op->getOpcode() == ISD::SUB;
+  if (Op->getOpcode() != ISD::ADD && !IsSub) {
+    return false;
+  }
+  Base   = Op->getOperand(0);
+  Offset = Op->getOperand(1);
+  if (Base != Ptr) {
+    if (IsSub || Offset != Ptr) {
+      return false;
+    }
+    std::swap(Base, Offset);
+  }
+
+  if (ConstantSDNode *CN = dyn_cast<ConstantSDNode>(Offset)) {
+    int64_t Imm = CN->getSExtValue();
+    if (Imm % Size != 0 || !isInt<11>(Imm / Size)) {
+      return false;
+    }
+  }
+  AM = IsSub ? ISD::POST_DEC : ISD::POST_INC;
+  return true;
+}
+
 SDValue EpiphanyTargetLowering::LowerGlobalAddress(SDValue Op, SelectionDAG &DAG) const {
   SDLoc DL(Op);
 
@@ -130,6 +560,15 @@ SDValue EpiphanyTargetLowering::LowerGlobalAddress(SDValue Op, SelectionDAG &DAG
   //return DAG.getNode(EpiphanyISD::MOV, DL, PTY, Addr);
   /*} else {*/
   SDValue AddrLow  = DAG.getTargetGlobalAddress(GV, DL, PTY, Offset, EpiphanyII::MO_LOW);
+
+  // Core-local addresses fit into 16 bits, so MOV alone is enough
+  const EpiphanyTargetObjectFile *TLOF =
+    static_cast<const EpiphanyTargetObjectFile *>(getTargetMachine().getObjFileLowering());
+  const GlobalObject *GO = GV->getBaseObject();
+  if (GO && TLOF->IsGlobalInLocalMemory(GO, getTargetMachine())) {
+    return DAG.getNode(EpiphanyISD::MOV, DL, PTY, AddrLow);
+  }
+
   SDValue AddrHigh = DAG.getTargetGlobalAddress(GV, DL, PTY, Offset, EpiphanyII::MO_HIGH);
   SDValue Low = DAG.getNode(EpiphanyISD::MOV, DL, PTY, AddrLow);
   return DAG.getNode(EpiphanyISD::MOVT, DL, PTY, Low, AddrHigh);
@@ -146,6 +585,220 @@ SDValue EpiphanyTargetLowering::LowerExternalSymbol(SDValue Op,
   return DAG.getNode(EpiphanyISD::MOV, dl, PtrVT, Result);
 }
 
+SDValue EpiphanyTargetLowering::LowerJumpTable(SDValue Op,
+    SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  int JTI = cast<JumpTableSDNode>(Op)->getIndex();
+  auto PTY = getPointerTy(DAG.getDataLayout());
+
+  SDValue AddrLow  = DAG.getTargetJumpTable(JTI, PTY, EpiphanyII::MO_LOW);
+  SDValue AddrHigh = DAG.getTargetJumpTable(JTI, PTY, EpiphanyII::MO_HIGH);
+  SDValue Low = DAG.getNode(EpiphanyISD::MOV, DL, PTY, AddrLow);
+  return DAG.getNode(EpiphanyISD::MOVT, DL, PTY, Low, AddrHigh);
+}
+
+// Jump table entries are absolute block addresses, emitted as .word
+unsigned EpiphanyTargetLowering::getJumpTableEncoding() const {
+  return MachineJumpTableInfo::EK_BlockAddress;
+}
+
+// High part of 32x32 multiplication, done with four 16x16 multiplications
+// (Hacker's Delight 8-2). Halves of the multiplier are constant for magic
+// number division, so those multiplications usually become shifts and adds.
+SDValue EpiphanyTargetLowering::LowerMULH(SDValue Op, SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  EVT VT = Op.getValueType();
+  unsigned ShiftOpc = (Op.getOpcode() == ISD::MULHS) ? ISD::SRA : ISD::SRL;
+  SDValue Mask = DAG.getConstant(0xffff, DL, VT);
+  SDValue Half = DAG.getConstant(16, DL, VT);
+
+  SDValue U = Op.getOperand(0);
+  SDValue V = Op.getOperand(1);
+  SDValue U0 = DAG.getNode(ISD::AND, DL, VT, U, Mask);
+  SDValue U1 = DAG.getNode(ShiftOpc, DL, VT, U, Half);
+  SDValue V0 = DAG.getNode(ISD::AND, DL, VT, V, Mask);
+  SDValue V1 = DAG.getNode(ShiftOpc, DL, VT, V, Half);
+
+  SDValue W0 = DAG.getNode(ISD::MUL, DL, VT, U0, V0);
+  SDValue T = DAG.getNode(ISD::ADD, DL, VT, DAG.getNode(ISD::MUL, DL, VT, U1, V0),
+      DAG.getNode(ISD::SRL, DL, VT, W0, Half));
+  SDValue W1 = DAG.getNode(ISD::ADD, DL, VT, DAG.getNode(ISD::MUL, DL, VT, U0, V1),
+      DAG.getNode(ISD::AND, DL, VT, T, Mask));
+  SDValue W2 = DAG.getNode(ShiftOpc, DL, VT, T, Half);
+
+  SDValue Hi = DAG.getNode(ISD::ADD, DL, VT, DAG.getNode(ISD::MUL, DL, VT, U1, V1), W2);
+  return DAG.getNode(ISD::ADD, DL, VT, Hi, DAG.getNode(ShiftOpc, DL, VT, W1, Half));
+}
+
+// The inline division and square root are not correctly rounded, the seeds
+// break down on zero, infinity, NaN and operands near the exponent limits, so
+// they are used only when the approximation is allowed, otherwise the runtime
+// library is called.
+
+// Division is multiplication by reciprocal, with the final residual correction
+// the result is within a few ulp for normal operands:
+//   q = a * x, q = q + x * (a - b * q)
+SDValue EpiphanyTargetLowering::LowerFDIV(SDValue Op, SelectionDAG &DAG) const {
+  const SDNodeFlags *Flags = Op->getFlags();
+  bool AllowRecip = Flags && (Flags->hasAllowReciprocal() || Flags->hasUnsafeAlgebra());
+  if (!DAG.getTarget().Options.UnsafeFPMath && !AllowRecip) {
+    return SDValue();
+  }
+
+  SDLoc DL(Op);
+  SDValue A = Op.getOperand(0);
+  SDValue B = Op.getOperand(1);
+  SDValue X = getReciprocal(B, 2, DAG);
+  SDValue Q = DAG.getNode(ISD::FMUL, DL, MVT::f32, A, X);
+  SDValue R = DAG.getNode(ISD::FSUB, DL, MVT::f32, A,
+      DAG.getNode(ISD::FMUL, DL, MVT::f32, B, Q));
+  return DAG.getNode(ISD::FADD, DL, MVT::f32, Q,
+      DAG.getNode(ISD::FMUL, DL, MVT::f32, R, X));
+}
+
+// Square root is refined together with the half of its reciprocal
+// (Goldschmidt), unlike a * rsqrt(a) this keeps sqrt(0) = 0:
+//   s = a * y, h = y / 2
+//   r = 1/2 - s * h, s = s + s * r, h = h + h * r
+// Negative operands don't produce NaN.
+SDValue EpiphanyTargetLowering::LowerFSQRT(SDValue Op, SelectionDAG &DAG) const {
+  if (!DAG.getTarget().Options.UnsafeFPMath) {
+    return SDValue();
+  }
+
+  SDLoc DL(Op);
+  SDValue A = Op.getOperand(0);
+  SDValue Y = getRsqrtSeed(A, DAG);
+  SDValue Half = DAG.getConstantFP(0.5, DL, MVT::f32);
+  SDValue S = DAG.getNode(ISD::FMUL, DL, MVT::f32, A, Y);
+  SDValue H = DAG.getNode(ISD::FMUL, DL, MVT::f32, Y, Half);
+  for (unsigned i = 0; i < 2; ++i) {
+    SDValue R = DAG.getNode(ISD::FSUB, DL, MVT::f32, Half,
+        DAG.getNode(ISD::FMUL, DL, MVT::f32, S, H));
+    S = DAG.getNode(ISD::FADD, DL, MVT::f32, S,
+        DAG.getNode(ISD::FMUL, DL, MVT::f32, S, R));
+    H = DAG.getNode(ISD::FADD, DL, MVT::f32, H,
+        DAG.getNode(ISD::FMUL, DL, MVT::f32, H, R));
+  }
+
+  // Final residual correction: s = s + h * (a - s * s)
+  SDValue R = DAG.getNode(ISD::FSUB, DL, MVT::f32, A,
+      DAG.getNode(ISD::FMUL, DL, MVT::f32, S, S));
+  return DAG.getNode(ISD::FADD, DL, MVT::f32, S,
+      DAG.getNode(ISD::FMUL, DL, MVT::f32, H, R));
+}
+
+// fmin/fmax are conditional moves. The fsub flags don't tell NaN apart, so
+// unless NaNs are excluded, each operand is checked on its bits and the
+// other one is returned if it's NaN:
+//   r = (b < a) ? b : a
+//   r = (|b| > inf) ? a : r
+//   r = (|a| > inf) ? b : r
+SDValue EpiphanyTargetLowering::LowerFMINMAX(SDValue Op, SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  SDValue A = Op.getOperand(0);
+  SDValue B = Op.getOperand(1);
+  SDValue Res;
+  if (Op.getOpcode() == ISD::FMINNUM) {
+    Res = DAG.getSelectCC(DL, B, A, B, A, ISD::SETOLT);
+  } else {
+    Res = DAG.getSelectCC(DL, A, B, B, A, ISD::SETOLT);
+  }
+  if (DAG.getTarget().Options.NoNaNsFPMath) {
+    return Res;
+  }
+
+  SDValue Inf = DAG.getConstant(0x7f800000, DL, MVT::i32);
+  auto getAbsBits = [&](SDValue X) {
+    return DAG.getNode(ISD::AND, DL, MVT::i32,
+        DAG.getNode(ISD::BITCAST, DL, MVT::i32, X),
+        DAG.getConstant(0x7fffffff, DL, MVT::i32));
+  };
+  Res = DAG.getSelectCC(DL, getAbsBits(B), Inf, A, Res, ISD::SETUGT);
+  return DAG.getSelectCC(DL, getAbsBits(A), Inf, B, Res, ISD::SETUGT);
+}
+
+/// Compare f32 operands into i32 0 or 1. The FPU flags don't tell NaN apart,
+/// so the NaN operands are found by their bits, like in LowerFMINMAX.
+SDValue EpiphanyTargetLowering::getFloatCmp(SDValue A, SDValue B, ISD::CondCode CC,
+    const SDLoc &DL, SelectionDAG &DAG) const {
+  // Predicate with the ordering left out, matched to fsub
+  ISD::CondCode PlainCC = ISD::CondCode((CC & 7) | 16);
+  SDValue Zero = DAG.getConstant(0, DL, MVT::i32);
+  SDValue One = DAG.getConstant(1, DL, MVT::i32);
+  if (DAG.getTarget().Options.NoNaNsFPMath) {
+    if (CC == ISD::SETO) {
+      return One;
+    }
+    if (CC == ISD::SETUO) {
+      return Zero;
+    }
+    return DAG.getSetCC(DL, MVT::i32, A, B, PlainCC);
+  }
+
+  SDValue Inf = DAG.getConstant(0x7f800000, DL, MVT::i32);
+  auto isNaN = [&](SDValue X) {
+    SDValue Bits = DAG.getNode(ISD::AND, DL, MVT::i32,
+        DAG.getNode(ISD::BITCAST, DL, MVT::i32, X),
+        DAG.getConstant(0x7fffffff, DL, MVT::i32));
+    return DAG.getSetCC(DL, MVT::i32, Bits, Inf, ISD::SETUGT);
+  };
+  SDValue NaN = DAG.getNode(ISD::OR, DL, MVT::i32, isNaN(A), isNaN(B));
+  switch (CC) {
+    case ISD::SETUO:
+      return NaN;
+    case ISD::SETO:
+      return DAG.getNode(ISD::XOR, DL, MVT::i32, NaN, One);
+    case ISD::SETONE:
+      return DAG.getNode(ISD::AND, DL, MVT::i32,
+          DAG.getSetCC(DL, MVT::i32, A, B, ISD::SETNE),
+          DAG.getNode(ISD::XOR, DL, MVT::i32, NaN, One));
+    default:
+      return DAG.getNode(ISD::OR, DL, MVT::i32,
+          DAG.getSetCC(DL, MVT::i32, A, B, PlainCC), NaN);
+  }
+}
+
+SDValue EpiphanyTargetLowering::LowerFCMP(SDValue Op, SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  SDValue Zero = DAG.getConstant(0, DL, MVT::i32);
+  switch (Op.getOpcode()) {
+    default:
+      llvm_unreachable("Unexpected float compare");
+    case ISD::SETCC: {
+      ISD::CondCode CC = cast<CondCodeSDNode>(Op.getOperand(2))->get();
+      return getFloatCmp(Op.getOperand(0), Op.getOperand(1), CC, DL, DAG);
+    }
+    case ISD::SELECT_CC: {
+      ISD::CondCode CC = cast<CondCodeSDNode>(Op.getOperand(4))->get();
+      SDValue Cmp = getFloatCmp(Op.getOperand(0), Op.getOperand(1), CC, DL, DAG);
+      return DAG.getSelectCC(DL, Cmp, Zero, Op.getOperand(2), Op.getOperand(3), ISD::SETUGT);
+    }
+    case ISD::BR_CC: {
+      ISD::CondCode CC = cast<CondCodeSDNode>(Op.getOperand(1))->get();
+      SDValue Cmp = getFloatCmp(Op.getOperand(2), Op.getOperand(3), CC, DL, DAG);
+      return DAG.getNode(ISD::BR_CC, DL, MVT::Other, Op.getOperand(0),
+          DAG.getCondCode(ISD::SETUGT), Cmp, Zero, Op.getOperand(4));
+    }
+  }
+}
+
+SDValue EpiphanyTargetLowering::LowerSTORE(SDValue Op, SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  StoreSDNode *ST = cast<StoreSDNode>(Op);
+
+  // Store i64 as a register pair, leave the rest to the default expansion
+  if (ST->isIndexed() || ST->isTruncatingStore() || ST->getAlignment() < 8) {
+    return SDValue();
+  }
+  SDValue Val = ST->getValue();
+  SDValue Lo = DAG.getNode(ISD::EXTRACT_ELEMENT, DL, MVT::i32, Val, DAG.getIntPtrConstant(0, DL));
+  SDValue Hi = DAG.getNode(ISD::EXTRACT_ELEMENT, DL, MVT::i32, Val, DAG.getIntPtrConstant(1, DL));
+  SDValue Ops[] = {ST->getChain(), Lo, Hi, ST->getBasePtr()};
+  return DAG.getMemIntrinsicNode(EpiphanyISD::STRD, DL, DAG.getVTList(MVT::Other),
+      Ops, MVT::i64, ST->getMemOperand());
+}
+
 //===----------------------------------------------------------------------===//
 //  Misc Lower Operation implementation
 //===----------------------------------------------------------------------===//
@@ -446,22 +1099,32 @@ EpiphanyTargetLowering::LowerCall(CallLoweringInfo &CLI, SmallVectorImpl<SDValue
     InFlag = Chain.getValue(1);
   }
 
-  // The linker is responsible for inserting veneers when necessary to put a
-  // function call destination in range, so we don't need to bother with a
-  // wrapper here.
-  // For internal linkage we can use BranchAndLink without regs, while for external it'd be better to use JALR
+  // BL reaches +/-16MB, which covers the local memory of the whole chip but
+  // not the shared DRAM window. The linker inserts no veneers, so calls are
+  // done through a register unless the short calls are asked for.
   EVT PTY = getPointerTy(DAG.getDataLayout());
   if (GlobalAddressSDNode *G = dyn_cast<GlobalAddressSDNode>(Callee)) {
     DEBUG(dbgs() << "\nArgument is a global value");
     const GlobalValue *GV = G->getGlobal();
-    SDValue AddrLow  = DAG.getTargetGlobalAddress(GV, DL, PTY, 0, EpiphanyII::MO_LOW);
-    SDValue AddrHigh = DAG.getTargetGlobalAddress(GV, DL, PTY, 0, EpiphanyII::MO_HIGH);
-    Callee = DAG.getNode(EpiphanyISD::MOV, DL, PTY, AddrLow);
-    Callee = DAG.getNode(EpiphanyISD::MOVT, DL, PTY, Callee, AddrHigh);
+    if (isLongCall(GV, MF.getFunction())) {
+      SDValue AddrLow  = DAG.getTargetGlobalAddress(GV, DL, PTY, 0, EpiphanyII::MO_LOW);
+      SDValue AddrHigh = DAG.getTargetGlobalAddress(GV, DL, PTY, 0, EpiphanyII::MO_HIGH);
+      Callee = DAG.getNode(EpiphanyISD::MOV, DL, PTY, AddrLow);
+      Callee = DAG.getNode(EpiphanyISD::MOVT, DL, PTY, Callee, AddrHigh);
+    } else {
+      Callee = DAG.getTargetGlobalAddress(GV, DL, PTY);
+    }
   } else if (ExternalSymbolSDNode *S = dyn_cast<ExternalSymbolSDNode>(Callee)) {
     DEBUG(dbgs() << "\nArgument is an external symbol");
     const char *Sym = S->getSymbol();
-    Callee = DAG.getTargetExternalSymbol(Sym, PTY);
+    if (isLongCall(nullptr, MF.getFunction())) {
+      SDValue AddrLow  = DAG.getTargetExternalSymbol(Sym, PTY, EpiphanyII::MO_LOW);
+      SDValue AddrHigh = DAG.getTargetExternalSymbol(Sym, PTY, EpiphanyII::MO_HIGH);
+      Callee = DAG.getNode(EpiphanyISD::MOV, DL, PTY, AddrLow);
+      Callee = DAG.getNode(EpiphanyISD::MOVT, DL, PTY, Callee, AddrHigh);
+    } else {
+      Callee = DAG.getTargetExternalSymbol(Sym, PTY);
+    }
   }
 
   // We produce the following DAG scheme for the actual call instruction:
@@ -506,6 +1169,37 @@ EpiphanyTargetLowering::LowerCall(CallLoweringInfo &CLI, SmallVectorImpl<SDValue
   return LowerCallResult(Chain, InFlag, CallConv, IsVarArg, Ins, DL, DAG, InVals);
 }
 
+// Check if the call to GV (or to a library function if GV is null) from
+// Caller has to be done with MOV/MOVT and JALR
+bool EpiphanyTargetLowering::isLongCall(const GlobalValue *GV,
+    const Function *Caller) const {
+  const Function *Callee = GV ? dyn_cast<Function>(GV) : nullptr;
+
+  // Code placed in the external memory is out of BL range, both ways
+  const EpiphanyTargetObjectFile *TLOF =
+    static_cast<const EpiphanyTargetObjectFile *>(getTargetMachine().getObjFileLowering());
+  if (TLOF->IsGlobalInExternalMemory(Caller, getTargetMachine())) {
+    return true;
+  }
+  const GlobalObject *GO = GV ? GV->getBaseObject() : nullptr;
+  if (GO && TLOF->IsGlobalInExternalMemory(GO, getTargetMachine())) {
+    return true;
+  }
+
+  // Callee attributes win over the caller ones
+  if (Callee && Callee->hasFnAttribute("long-call")) {
+    return true;
+  }
+  if (Callee && Callee->hasFnAttribute("short-call")) {
+    return false;
+  }
+  if (Caller->hasFnAttribute("long-call")) {
+    return true;
+  }
+
+  return !(ShortCalls || Caller->hasFnAttribute("short-call"));
+}
+
 //===----------------------------------------------------------------------===//
 //@            Call Return Parameters Calling Convention Implementation
 //===----------------------------------------------------------------------===//
@@ -46,7 +46,15 @@ namespace llvm {
 
       // Store and load instruction wrappers
       STORE,
-      LOAD
+      LOAD,
+
+      // FIX with the rounding of CONFIG.RMODE, round to nearest by default.
+      // Unlike FP_TO_SINT it is not assumed to truncate.
+      FIX_RN,
+
+      // Double word load and store of the register pair
+      LDRD = ISD::FIRST_TARGET_MEMORY_OPCODE,
+      STRD
     };
   }
 
@@ -68,8 +76,33 @@ namespace llvm {
       // Offset handling for arrays for non-PIC mode
       bool isOffsetFoldingLegal(const GlobalAddressSDNode *GA) const override;
 
+      /// isLegalAddressingMode - Return true if the addressing mode represented
+      /// by AM is legal for this target, for a load/store of the specified type.
+      bool isLegalAddressingMode(const DataLayout &DL, const AddrMode &AM,
+          Type *Ty, unsigned AS) const override;
+
+      // Post-modify addressing for loads and stores
+      bool getPostIndexedAddressParts(SDNode *N, SDNode *Op, SDValue &Base,
+          SDValue &Offset, ISD::MemIndexedMode &AM,
+          SelectionDAG &DAG) const override;
+
       SDValue LowerOperation(SDValue Op, SelectionDAG &DAG) const override;
 
+      unsigned getJumpTableEncoding() const override;
+
+      SDValue PerformDAGCombine(SDNode *N, DAGCombinerInfo &DCI) const override;
+
+      // Reciprocal and reciprocal square root seeds for -ffast-math
+      SDValue getRecipEstimate(SDValue Operand, DAGCombinerInfo &DCI,
+          unsigned &RefinementSteps) const override;
+      SDValue getRsqrtEstimate(SDValue Operand, DAGCombinerInfo &DCI,
+          unsigned &RefinementSteps, bool &UseOneConstNR) const override;
+
+      /// ReplaceNodeResults - Replace the results of node with an illegal result
+      /// type with new values built out of custom code.
+      void ReplaceNodeResults(SDNode *N, SmallVectorImpl<SDValue> &Results,
+          SelectionDAG &DAG) const override;
+
     protected:
       /// ByValArgInfo - Byval argument information.
       struct ByValArgInfo {
@@ -140,6 +173,23 @@ namespace llvm {
       // Lower Operand specifics
       SDValue LowerGlobalAddress(SDValue Op, SelectionDAG &DAG) const;
       SDValue LowerExternalSymbol(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerJumpTable(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerSTORE(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerMULH(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerFDIV(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerFSQRT(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerFMINMAX(SDValue Op, SelectionDAG &DAG) const;
+      SDValue LowerFCMP(SDValue Op, SelectionDAG &DAG) const;
+      SDValue getFloatCmp(SDValue A, SDValue B, ISD::CondCode CC,
+                          const SDLoc &DL, SelectionDAG &DAG) const;
+
+      // DAG combines
+      SDValue PerformADDCombine(SDNode *N, DAGCombinerInfo &DCI) const;
+      SDValue PerformMULCombine(SDNode *N, DAGCombinerInfo &DCI) const;
+      SDValue PerformDIVCombine(SDNode *N, DAGCombinerInfo &DCI) const;
+
+      // Maximum number of shifts and adds replacing multiplication by constant
+      unsigned MaxMulOps;
 
       //- must be exist even without function all
       SDValue LowerFormalArguments(SDValue Chain,
@@ -157,6 +207,8 @@ namespace llvm {
       SDValue LowerCall(TargetLowering::CallLoweringInfo &CLI,
           SmallVectorImpl<SDValue> &InVals) const override;
 
+      bool isLongCall(const GlobalValue *GV, const Function *Caller) const;
+
       SDValue LowerCallResult(SDValue Chain, SDValue InFlag,
           CallingConv::ID CallConv, bool isVarArg,
           const SmallVectorImpl<ISD::InputArg> &Ins,
@@ -0,0 +1,96 @@
+//===-----------------EpiphanyInstrCompression.cpp-------------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass rewrites 32-bit instructions into their 16-bit encodings after
+// register allocation, when all registers are R0-R7 and immediates fit the
+// short fields (see EpiphanyInstrInfo::getShortOpcode). Operand lists of both
+// forms are the same, so only the opcode is changed.
+//
+//  Branches are shortened too, except the float less-than ones. The ones that
+//  don't reach their destination are made long again by the generic branch
+//  relaxation pass that follows.
+//
+//  Hardware loop bodies are left alone, as the loop is kept in 32-bit
+//  instructions.
+//
+
+#include "EpiphanyInstrCompression.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "epiphany_compress"
+
+static cl::opt<bool> DisableCompression("disable-epiphany-compression",
+    cl::Hidden, cl::init(false), cl::desc("Disable Epiphany 16-bit instruction compression"));
+
+STATISTIC(NumCompressed, "Number of instructions compressed to 16 bits");
+
+char EpiphanyInstrCompression::ID = 0;
+
+// Get the 16-bit form of the branch, or 0 if there's none. Float less-than
+// conditions can't be reversed, and branch relaxation reverses the condition
+// of a short branch that is out of range, so these are kept 32-bit.
+static unsigned getShortBranchOpcode(const MachineInstr &MI) {
+  switch (MI.getOpcode()) {
+    default:
+      return 0;
+    case Epiphany::BNONE32:
+      return Epiphany::BNONE16;
+    case Epiphany::BCC32: {
+      int64_t CC = MI.getOperand(1).getImm();
+      if (CC == EpiphanyCC::COND_BLT || CC == EpiphanyCC::COND_BLTE) {
+        return 0;
+      }
+      return Epiphany::BCC16;
+    }
+  }
+}
+
+bool EpiphanyInstrCompression::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableCompression || skipFunction(*MF.getFunction())) {
+    return false;
+  }
+
+  DEBUG(dbgs() << "\nRunning Epiphany 16-bit instruction compression pass\n");
+  TII = MF.getSubtarget<EpiphanySubtarget>().getInstrInfo();
+
+  bool Changed = false;
+  for (MachineBasicBlock &MBB : MF) {
+    if (TII->isHardwareLoopBody(MBB)) {
+      continue;
+    }
+    Changed |= compressBlock(MBB);
+  }
+  return Changed;
+}
+
+bool EpiphanyInstrCompression::compressBlock(MachineBasicBlock &MBB) {
+  bool Changed = false;
+  for (MachineInstr &MI : MBB) {
+    // Direct branches are matched by opcode, JR goes through the table
+    unsigned Opc = getShortBranchOpcode(MI);
+    if (!Opc) {
+      Opc = TII->getShortOpcode(MI);
+    }
+    if (!Opc) {
+      continue;
+    }
+    DEBUG(dbgs() << "Compressing " << MI);
+    MI.setDesc(TII->get(Opc));
+    ++NumCompressed;
+    Changed = true;
+  }
+  return Changed;
+}
+
+//===----------------------------------------------------------------------===//
+//                         Public Constructor Functions
+//===----------------------------------------------------------------------===//
+FunctionPass *llvm::createEpiphanyInstrCompressionPass() {
+  return new EpiphanyInstrCompression();
+}
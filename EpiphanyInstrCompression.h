@@ -0,0 +1,44 @@
+//===-----------------EpiphanyInstrCompression.h---------------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYINSTRCOMPRESSION_H
+#define _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYINSTRCOMPRESSION_H
+
+#include "Epiphany.h"
+#include "EpiphanyConfig.h"
+#include "EpiphanySubtarget.h"
+#include "EpiphanyTargetMachine.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Target/TargetInstrInfo.h"
+
+namespace llvm {
+
+  class EpiphanyInstrCompression : public MachineFunctionPass {
+
+    private:
+      const EpiphanyInstrInfo *TII;
+
+      bool compressBlock(MachineBasicBlock &MBB);
+
+    public:
+      static char ID;
+      EpiphanyInstrCompression() : MachineFunctionPass(ID) {}
+
+      StringRef getPassName() const {
+        return "Epiphany 16-bit instruction compression pass";
+      }
+      bool runOnMachineFunction(MachineFunction &MF);
+  };
+
+} // namespace llvm
+
+#endif
@@ -17,8 +17,12 @@
 #include "EpiphanyTargetMachine.h"
 #include "EpiphanyMachineFunction.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/CodeGen/DFAPacketizer.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/TargetRegistry.h"
 
 using namespace llvm;
@@ -27,6 +31,7 @@ using namespace llvm;
 
 #define GET_INSTRINFO_CTOR_DTOR
 #include "EpiphanyGenInstrInfo.inc"
+#include "EpiphanyGenDFAPacketizer.inc"
 
 // Pin the vtable to this file.
 void EpiphanyInstrInfo::anchor() {}
@@ -50,6 +55,9 @@ bool EpiphanyInstrInfo::expandPostRAPseudo(MachineInstr &MI) const {
     case Epiphany::RTS:
       expandRTS(MBB, MI);
       break;
+    case Epiphany::DMASTART:
+      expandDMASTART(MBB, MI);
+      break;
     default:
       return false;
   }
@@ -103,13 +111,18 @@ bool EpiphanyInstrInfo::analyzeBranch(MachineBasicBlock &MBB, MachineBasicBlock
       return true;
     }
 
-    // Indirect branches with links are not handled
-    if (I->getOpcode() == Epiphany::BL32 || I->getOpcode() == Epiphany::JR32) {
+    // Hardware loop end can't be analyzed
+    if (I->getOpcode() == Epiphany::LOOPEND) {
+      return true;
+    }
+
+    // Indirect branches are not handled
+    if (I->getOpcode() == Epiphany::JR16 || I->getOpcode() == Epiphany::JR32) {
       return true;
     }
 
     // Handle unconditional branches.
-    if (I->getOpcode() == Epiphany::BNONE32) {
+    if (I->getOpcode() == Epiphany::BNONE32 || I->getOpcode() == Epiphany::BNONE16) {
       UnCondBrIter = I;
 
       // If modification is not allowed
@@ -141,7 +154,7 @@ bool EpiphanyInstrInfo::analyzeBranch(MachineBasicBlock &MBB, MachineBasicBlock
     }
 
     // Handle conditional branches.
-    if (I->getOpcode() != Epiphany::BCC32) {
+    if (I->getOpcode() != Epiphany::BCC32 && I->getOpcode() != Epiphany::BCC16) {
       continue;
     }
     EpiphanyCC::CondCodes BranchCode = static_cast<EpiphanyCC::CondCodes>(I->getOperand(1).getImm());
@@ -150,13 +163,16 @@ bool EpiphanyInstrInfo::analyzeBranch(MachineBasicBlock &MBB, MachineBasicBlock
     if (Cond.empty()) {
       FBB = TBB;
       TBB = I->getOperand(0).getMBB();
+      // Condition code and the compare result, which orders the selects and
+      // predicated moves after the compare
       Cond.push_back(MachineOperand::CreateImm(BranchCode));
+      Cond.push_back(MachineOperand::CreateReg(I->getOperand(2).getReg(), false));
       continue;
     }
 
     // Handle subsequent conditional branches. Only handle the case where all
     // conditional branches branch to the same destination.
-    assert(Cond.size() == 1 && "Condition size is bigger than 1");
+    assert(Cond.size() == 2 && "Condition size is not 2");
     assert(TBB && "Target basic block not set");
 
     // Only handle the case where all conditional branches branch to
@@ -178,13 +194,15 @@ bool EpiphanyInstrInfo::analyzeBranch(MachineBasicBlock &MBB, MachineBasicBlock
 // removeBranch - helper function for branch analysis
 // Used with IfConversion pass
 unsigned EpiphanyInstrInfo::removeBranch(MachineBasicBlock &MBB, int *BytesRemoved) const {
-  assert(!BytesRemoved && "code size not handled");
-
   // Branches to handle
   DEBUG(dbgs() << "\nRemoving branches out of BB#" << MBB.getNumber());
-  unsigned uncond[] = {Epiphany::BNONE32, Epiphany::BL32, Epiphany::BCC32};
+  unsigned uncond[] = {Epiphany::BNONE32, Epiphany::BCC32,
+    Epiphany::BNONE16, Epiphany::BCC16};
   MachineBasicBlock::iterator I = MBB.end();
   unsigned Count = 0;
+  if (BytesRemoved) {
+    *BytesRemoved = 0;
+  }
 
   while (I != MBB.begin()) {
     --I;
@@ -197,6 +215,9 @@ unsigned EpiphanyInstrInfo::removeBranch(MachineBasicBlock &MBB, int *BytesRemov
       break;
     }
     // Remove the branch.
+    if (BytesRemoved) {
+      *BytesRemoved += getInstSizeInBytes(*I);
+    }
     I->eraseFromParent();
     I = MBB.end();
     ++Count;
@@ -205,25 +226,37 @@ unsigned EpiphanyInstrInfo::removeBranch(MachineBasicBlock &MBB, int *BytesRemov
   return Count;
 }
 
+// After register allocation the compare result may be dead or reused by the
+// time the flags are read, it's only kept as an ordering hint
+static unsigned getFlagRegState(unsigned FlagReg) {
+  return TargetRegisterInfo::isPhysicalRegister(FlagReg) ? RegState::Undef : 0;
+}
+
 unsigned EpiphanyInstrInfo::insertBranch(MachineBasicBlock &MBB,
     MachineBasicBlock *TBB, MachineBasicBlock *FBB,	ArrayRef<MachineOperand> Cond,
     const DebugLoc &DL, int *BytesAdded) const {
   // Shouldn't be a fall through.
   assert(TBB && "InsertBranch must not be told to insert a fallthrough");
-  assert((Cond.size() == 1 || Cond.size() == 0) &&
-      "Branch conditions have one component!");
-  assert(!BytesAdded && "code size not handled");
+  assert(Cond.size() <= 2 && "Branch conditions have one component and an optional flag register!");
 
+  // Branches are inserted in 32-bit form, the loop passes expect it. They are
+  // shortened by the compression pass after that.
   if (Cond.empty()) {
     // Unconditional branch?
     assert(!FBB && "Unconditional branch with multiple successors!");
     BuildMI(&MBB, DL, get(Epiphany::BNONE32)).addMBB(TBB);
+    if (BytesAdded) {
+      *BytesAdded = 4;
+    }
     return 1;
   }
 
   // Conditional branch.
   unsigned Count = 0;
-  BuildMI(&MBB, DL, get(Epiphany::BCC32)).addMBB(TBB).addImm(Cond[0].getImm()).addReg(Epiphany::R0);
+  // Compare result is missing only in conditions built by hand
+  unsigned FlagReg = (Cond.size() > 1) ? Cond[1].getReg() : (unsigned)Epiphany::R0;
+  BuildMI(&MBB, DL, get(Epiphany::BCC32)).addMBB(TBB).addImm(Cond[0].getImm())
+    .addReg(FlagReg, getFlagRegState(FlagReg));
   ++Count;
 
   if (FBB) {
@@ -231,20 +264,59 @@ unsigned EpiphanyInstrInfo::insertBranch(MachineBasicBlock &MBB,
     BuildMI(&MBB, DL, get(Epiphany::BNONE32)).addMBB(FBB);
     ++Count;
   }
+  if (BytesAdded) {
+    *BytesAdded = Count * 4;
+  }
   return Count;
 }
 
+MachineBasicBlock *EpiphanyInstrInfo::getBranchDestBlock(const MachineInstr &MI) const {
+  return MI.getOperand(0).getMBB();
+}
+
+// Displacement is counted in half-words from the branch
+bool EpiphanyInstrInfo::isBranchOffsetInRange(unsigned BranchOpc, int64_t BrOffset) const {
+  switch (BranchOpc) {
+    default:
+      llvm_unreachable("Unexpected branch opcode!");
+    case Epiphany::BNONE16:
+    case Epiphany::BCC16:
+      return isShiftedInt<8, 1>(BrOffset);
+    case Epiphany::BNONE32:
+    case Epiphany::BCC32:
+      return isShiftedInt<24, 1>(BrOffset);
+    case Epiphany::LOOPEND:
+      // Loop start and end are kept in registers
+      return true;
+  }
+}
+
+// The 32-bit branch reaches the whole 16MB of the core address space, so
+// the register scavenger is not needed
+unsigned EpiphanyInstrInfo::insertIndirectBranch(MachineBasicBlock &MBB,
+    MachineBasicBlock &NewDestBB, const DebugLoc &DL, int64_t BrOffset,
+    RegScavenger *RS) const {
+  assert(isBranchOffsetInRange(Epiphany::BNONE32, BrOffset) && "Branch out of range");
+  BuildMI(&MBB, DL, get(Epiphany::BNONE32)).addMBB(&NewDestBB);
+  return 4;
+}
+
 bool EpiphanyInstrInfo::reverseBranchCondition(SmallVectorImpl<MachineOperand> &Cond) const {
-  assert(Cond.size() == 1 && "More than 1 condition");
+  assert(!Cond.empty() && Cond.size() <= 2 && "Invalid branch condition");
   EpiphanyCC::CondCodes CC = static_cast<EpiphanyCC::CondCodes>(Cond[0].getImm());
   switch(CC) {
     default:
       llvm_unreachable("Wrong branch condition code!");
     case EpiphanyCC::COND_BEQ:
+      CC = EpiphanyCC::COND_BNE;
+      break;
     case EpiphanyCC::COND_BNE:
+      CC = EpiphanyCC::COND_BEQ;
+      break;
     case EpiphanyCC::COND_BLT:
     case EpiphanyCC::COND_BLTE:
-      llvm_unreachable("Unimplemented reverse conditions");
+      // No float greater-than conditions
+      return true;
     case EpiphanyCC::COND_NONE:
     case EpiphanyCC::COND_L:
       llvm_unreachable("Unconditional branch cant be reversed");
@@ -284,6 +356,123 @@ bool EpiphanyInstrInfo::reverseBranchCondition(SmallVectorImpl<MachineOperand> &
   return false;
 }
 
+//-------------------------------------------------------------------
+// Predication and selects
+//-------------------------------------------------------------------
+// The only conditional instruction besides branches is MOVcc, so register
+// moves are predicated by IfConverter after register allocation and PHIs
+// are replaced with selects by EarlyIfConverter before it.
+
+bool EpiphanyInstrInfo::isPredicated(const MachineInstr &MI) const {
+  unsigned Opc = MI.getOpcode();
+  return Opc == Epiphany::MOVCC32rr || Opc == Epiphany::MOVCCf32rr;
+}
+
+bool EpiphanyInstrInfo::PredicateInstruction(MachineInstr &MI,
+    ArrayRef<MachineOperand> Pred) const {
+  unsigned Opc;
+  switch (MI.getOpcode()) {
+    case Epiphany::MOVi32rr:
+      Opc = Epiphany::MOVCC32rr;
+      break;
+    case Epiphany::MOVf32rr:
+      Opc = Epiphany::MOVCCf32rr;
+      break;
+    default:
+      return false;
+  }
+
+  // Rd = cc ? Rn : Rd
+  unsigned Rd = MI.getOperand(0).getReg();
+  unsigned FlagReg = (Pred.size() > 1) ? Pred[1].getReg() : (unsigned)Epiphany::R0;
+  MI.setDesc(get(Opc));
+  MachineInstrBuilder(*MI.getParent()->getParent(), &MI)
+    .addReg(Rd)
+    .addImm(Pred[0].getImm())
+    .addReg(FlagReg, getFlagRegState(FlagReg))
+    .addReg(Epiphany::STATUS, RegState::Implicit);
+  return true;
+}
+
+// Predicated code always executes, while the branch around it costs the
+// pipeline flush whenever it's taken. Costs are scaled to keep the precision
+// of the probabilities.
+static const unsigned IfCvtScale = 1 << 10;
+
+bool EpiphanyInstrInfo::isProfitableToIfCvt(MachineBasicBlock &MBB,
+    unsigned NumCycles, unsigned ExtraPredCycles,
+    BranchProbability Probability) const {
+  unsigned Penalty = Subtarget.getSchedModel().MispredictPenalty;
+  unsigned PredCost = (NumCycles + ExtraPredCycles) * IfCvtScale;
+  unsigned UnpredCost = Probability.scale(NumCycles * IfCvtScale) +
+    Probability.getCompl().scale(Penalty * IfCvtScale);
+  return PredCost <= UnpredCost;
+}
+
+bool EpiphanyInstrInfo::isProfitableToIfCvt(MachineBasicBlock &TMBB,
+    unsigned NumTCycles, unsigned ExtraTCycles, MachineBasicBlock &FMBB,
+    unsigned NumFCycles, unsigned ExtraFCycles,
+    BranchProbability Probability) const {
+  // One of the paths always has a taken branch
+  unsigned Penalty = Subtarget.getSchedModel().MispredictPenalty;
+  unsigned PredCost =
+    (NumTCycles + ExtraTCycles + NumFCycles + ExtraFCycles) * IfCvtScale;
+  unsigned UnpredCost = Probability.scale(NumTCycles * IfCvtScale) +
+    Probability.getCompl().scale(NumFCycles * IfCvtScale) +
+    Penalty * IfCvtScale;
+  return PredCost <= UnpredCost;
+}
+
+bool EpiphanyInstrInfo::isProfitableToDupForIfCvt(MachineBasicBlock &MBB,
+    unsigned NumCycles, BranchProbability Probability) const {
+  return NumCycles == 1;
+}
+
+static unsigned getSelectOpcode(const TargetRegisterClass *RC) {
+  if (Epiphany::GPR32RegClass.hasSubClassEq(RC)) {
+    return Epiphany::MOVCC32rr;
+  }
+  if (Epiphany::FPR32RegClass.hasSubClassEq(RC)) {
+    return Epiphany::MOVCCf32rr;
+  }
+  return 0;
+}
+
+bool EpiphanyInstrInfo::canInsertSelect(const MachineBasicBlock &MBB,
+    ArrayRef<MachineOperand> Cond, unsigned TrueReg, unsigned FalseReg,
+    int &CondCycles, int &TrueCycles, int &FalseCycles) const {
+  // MOVcc needs the compare result as the flag operand
+  if (Cond.size() != 2) {
+    return false;
+  }
+
+  const MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
+  const TargetRegisterClass *RC = RI.getCommonSubClass(
+      MRI.getRegClass(TrueReg), MRI.getRegClass(FalseReg));
+  if (!RC || !getSelectOpcode(RC)) {
+    return false;
+  }
+
+  // Single IALU instruction depending on all of the operands
+  CondCycles = TrueCycles = FalseCycles = 1;
+  return true;
+}
+
+void EpiphanyInstrInfo::insertSelect(MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I, const DebugLoc &DL, unsigned DstReg,
+    ArrayRef<MachineOperand> Cond, unsigned TrueReg, unsigned FalseReg) const {
+  const MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
+  unsigned Opc = getSelectOpcode(MRI.getRegClass(DstReg));
+  assert(Opc && "Can't select registers of this class");
+
+  // DstReg = cc ? TrueReg : FalseReg
+  BuildMI(MBB, I, DL, get(Opc), DstReg)
+    .addReg(TrueReg)
+    .addReg(FalseReg)
+    .addImm(Cond[0].getImm())
+    .addReg(Cond[1].getReg());
+}
+
 //-------------------------------------------------------------------
 // Misc
 //-------------------------------------------------------------------
@@ -316,7 +505,7 @@ bool EpiphanyInstrInfo::isSchedulingBoundary(const MachineInstr &MI,
   }
 
   // Don't mess around with no return calls.
-  unsigned uncond[] = {Epiphany::BNONE32, Epiphany::JR16, Epiphany::JR32};
+  unsigned uncond[] = {Epiphany::BNONE32, Epiphany::BNONE16, Epiphany::JR16, Epiphany::JR32};
   bool isNoReturn = std::find(std::begin(uncond), std::end(uncond), MI.getOpcode()) != std::end(uncond);
   if (isNoReturn)
     return true;
@@ -348,7 +537,8 @@ unsigned EpiphanyInstrInfo::isLoadFromStackSlot(const MachineInstr &MI,
   unsigned inst[] = {
     Epiphany::LDRi8_r32,  Epiphany::LDRi8u_r32, 
     Epiphany::LDRi16_r32, Epiphany::LDRi16u_r32, 
-    Epiphany::LDRi32_r32, Epiphany::LDRf32
+    Epiphany::LDRi32_r32, Epiphany::LDRf32,
+    Epiphany::LDRi64_r32
   };
   DEBUG(dbgs() << "\nisLoadToStackSlot for "; MI.print(dbgs()));
   // Check if current opcode is one of those
@@ -372,7 +562,8 @@ unsigned EpiphanyInstrInfo::isStoreToStackSlot(const MachineInstr &MI,
     int &FrameIndex) const {
   unsigned inst[] = {
     Epiphany::STRi8_r32,  Epiphany::STRi16_r32,
-    Epiphany::STRi32_r32, Epiphany::STRf32
+    Epiphany::STRi32_r32, Epiphany::STRf32,
+    Epiphany::STRi64_r32
   };
   DEBUG(dbgs() << "\nisStoreToStackSlot for "; MI.print(dbgs()));
   // Check if current opcode is one of those
@@ -393,7 +584,9 @@ void EpiphanyInstrInfo::storeRegToStackSlot(MachineBasicBlock &MBB,
     const TargetRegisterClass *Rd, const TargetRegisterInfo *TRI) const {
   DebugLoc DL;
   // Get instruction, for stack slots (FP/SP) we can only use 32-bit instructions
-  unsigned STRi32_r32 = Epiphany::STRi32_r32;
+  // Register pairs are spilled with a single double word store
+  unsigned STRi32_r32 = Epiphany::GPR64RegClass.hasSubClassEq(Rd) ?
+    Epiphany::STRi64_r32 : Epiphany::STRi32_r32;
 
   // Get function and frame info
   if (MI != MBB.end()) DL = MI->getDebugLoc();
@@ -417,7 +610,8 @@ void EpiphanyInstrInfo::loadRegFromStackSlot(MachineBasicBlock &MBB,
     const TargetRegisterClass *Rd, const TargetRegisterInfo *TRI) const {
   DebugLoc DL;
   // Get instruction, we can only use 32-bit instructions
-  unsigned LDRi32_r32 = Epiphany::LDRi32_r32;
+  unsigned LDRi32_r32 = Epiphany::GPR64RegClass.hasSubClassEq(Rd) ?
+    Epiphany::LDRi64_r32 : Epiphany::LDRi32_r32;
 
   // Get function and frame info
   if (MI != MBB.end()) DL = MI->getDebugLoc();
@@ -440,6 +634,16 @@ void EpiphanyInstrInfo::copyPhysReg(MachineBasicBlock &MBB,
     unsigned SrcReg, bool KillSrc) const {
   unsigned Opc = 0;
 
+  // Register pair is copied word by word
+  if (Epiphany::GPR64RegClass.contains(DestReg, SrcReg)) {
+    const TargetRegisterInfo &TRI = getRegisterInfo();
+    BuildMI(MBB, I, DL, get(Epiphany::MOVi32rr), TRI.getSubReg(DestReg, Epiphany::isub_lo))
+      .addReg(TRI.getSubReg(SrcReg, Epiphany::isub_lo), getKillRegState(KillSrc));
+    BuildMI(MBB, I, DL, get(Epiphany::MOVi32rr), TRI.getSubReg(DestReg, Epiphany::isub_hi))
+      .addReg(TRI.getSubReg(SrcReg, Epiphany::isub_hi), getKillRegState(KillSrc));
+    return;
+  }
+
   // TODO: Should make it work for all 4 ways (i32 <-> f32)
   if (Epiphany::GPR32RegClass.contains(DestReg, SrcReg)) { // Copy between regs
     Opc = Epiphany::MOVi32rr;
@@ -480,13 +684,706 @@ void EpiphanyInstrInfo::expandRTS(MachineBasicBlock &MBB,
     MachineBasicBlock::iterator I) const {
   BuildMI(MBB, I, I->getDebugLoc(), get(Epiphany::JR32)).addReg(Epiphany::LR);
 }
+
+// Writing the config with DMASTARTUP set makes the channel fetch its
+// descriptor and start the transfer
+void EpiphanyInstrInfo::expandDMASTART(MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I) const {
+  unsigned Config = I->getOperand(1).getImm() ? Epiphany::DMA1CONFIG : Epiphany::DMA0CONFIG;
+  BuildMI(MBB, I, I->getDebugLoc(), get(Epiphany::MOVTSDMA32rr), Config)
+    .addReg(I->getOperand(0).getReg(), getKillRegState(I->getOperand(0).isKill()));
+}
 // }
 
 // Return the number of bytes of code the specified instruction may be.
-unsigned EpiphanyInstrInfo::GetInstSizeInBytes(const MachineInstr &MI) const {
+unsigned EpiphanyInstrInfo::getInstSizeInBytes(const MachineInstr &MI) const {
   switch (MI.getOpcode()) {
     default:
       return MI.getDesc().getSize();
+    case Epiphany::LOOPEND:
+      // Up to 6 bytes of alignment before the last instruction, and a nop
+      // if the loop body is empty
+      return 8;
+    case TargetOpcode::INLINEASM: {
+      const MachineFunction *MF = MI.getParent()->getParent();
+      const char *AsmStr = MI.getOperand(0).getSymbolName();
+      return getInlineAsmLength(AsmStr, *MF->getTarget().getMCAsmInfo());
+    }
   }
 }
 // }
+
+//-------------------------------------------------------------------
+// 16-bit forms
+//-------------------------------------------------------------------
+namespace {
+  // Immediate restrictions of the 16-bit form
+  enum ShortImmKind {
+    SI_None,
+    SI_Simm3,
+    SI_Uimm8,
+    SI_Disp3
+  };
+
+  struct ShortForm {
+    unsigned R32;
+    unsigned R16;
+    ShortImmKind Kind;
+    unsigned Size;
+  };
+}
+
+#define RR_FORM(Name) { Epiphany::Name##_r32, Epiphany::Name##_r16, SI_None, 0 }
+#define LS_FORMS(Name, Size) \
+  { Epiphany::Name##_r32, Epiphany::Name##_r16, SI_Disp3, Size }, \
+  { Epiphany::Name##_idx_add_r32, Epiphany::Name##_idx_add_r16, SI_None, 0 }, \
+  { Epiphany::Name##_pm_add_r32, Epiphany::Name##_pm_add_r16, SI_None, 0 }
+
+static const ShortForm ShortForms[] = {
+  RR_FORM(ADDrr), RR_FORM(SUBrr), RR_FORM(ADDCrr), RR_FORM(SUBCrr),
+  RR_FORM(ANDrr), RR_FORM(ORRrr), RR_FORM(EORrr),
+  RR_FORM(ASRrr), RR_FORM(LSRrr), RR_FORM(LSLrr),
+  RR_FORM(FADDrr), RR_FORM(FSUBrr), RR_FORM(FMULrr), RR_FORM(FMADDrr), RR_FORM(FMSUBrr),
+  RR_FORM(IADDrr), RR_FORM(ISUBrr), RR_FORM(IMULrr), RR_FORM(IMADDrr), RR_FORM(IMSUBrr),
+  { Epiphany::ADD32ri,  Epiphany::ADD16ri,  SI_Simm3, 0 },
+  { Epiphany::SUB32ri,  Epiphany::SUB16ri,  SI_Simm3, 0 },
+  { Epiphany::LSR32ri,  Epiphany::LSR16ri,  SI_None,  0 },
+  { Epiphany::LSL32ri,  Epiphany::LSL16ri,  SI_None,  0 },
+  { Epiphany::ASR32ri,  Epiphany::ASR16ri,  SI_None,  0 },
+  { Epiphany::MOVi32ri, Epiphany::MOVi16ri, SI_Uimm8, 0 },
+  { Epiphany::JR32,     Epiphany::JR16,     SI_None,  0 },
+  LS_FORMS(LDRi8,   1),
+  LS_FORMS(LDRi8u,  1),
+  LS_FORMS(LDRi8z,  1),
+  LS_FORMS(LDRi16,  2),
+  LS_FORMS(LDRi16u, 2),
+  LS_FORMS(LDRi16z, 2),
+  LS_FORMS(LDRi32,  4),
+  LS_FORMS(STRi8,   1),
+  LS_FORMS(STRi16,  2),
+  LS_FORMS(STRi32,  4),
+};
+
+#undef RR_FORM
+#undef LS_FORMS
+
+static const ShortForm *getShortForm(unsigned Opc) {
+  for (const ShortForm &Entry : ShortForms) {
+    if (Entry.R32 == Opc) {
+      return &Entry;
+    }
+  }
+  return nullptr;
+}
+
+bool EpiphanyInstrInfo::hasShortForm(unsigned Opc) const {
+  return getShortForm(Opc) != nullptr;
+}
+
+// All registers should be R0-R7, immediates should fit the short field
+unsigned EpiphanyInstrInfo::getShortOpcode(const MachineInstr &MI) const {
+  const ShortForm *Form = getShortForm(MI.getOpcode());
+  if (!Form) {
+    return 0;
+  }
+
+  for (unsigned i = 0, e = MI.getDesc().getNumOperands(); i != e; ++i) {
+    const MachineOperand &MO = MI.getOperand(i);
+    if (MO.isReg()) {
+      if (!Epiphany::GPR16RegClass.contains(MO.getReg())) {
+        return 0;
+      }
+      continue;
+    }
+
+    // Symbols and frame indices are left in 32-bit form
+    if (!MO.isImm()) {
+      return 0;
+    }
+    int64_t Imm = MO.getImm();
+    switch (Form->Kind) {
+      case SI_None:
+        break;
+      case SI_Simm3:
+        if (!isInt<3>(Imm)) {
+          return 0;
+        }
+        break;
+      case SI_Uimm8:
+        if (!isUInt<8>(Imm)) {
+          return 0;
+        }
+        break;
+      case SI_Disp3:
+        // Displacement is scaled by the access size
+        if (Imm < 0 || Imm % Form->Size != 0 || !isUInt<3>(Imm / Form->Size)) {
+          return 0;
+        }
+        break;
+    }
+  }
+  return Form->R16;
+}
+
+bool EpiphanyInstrInfo::isHardwareLoopBody(const MachineBasicBlock &MBB) const {
+  for (const MachineInstr &MI : MBB.terminators()) {
+    if (MI.getOpcode() == Epiphany::LOOPEND) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-------------------------------------------------------------------
+// Software pipelining
+//-------------------------------------------------------------------
+// Get the signed step of "add/sub Rd, Rn, #imm"
+static bool getAddImmStep(const MachineInstr &MI, int64_t &Step) {
+  int64_t Sign;
+  switch (MI.getOpcode()) {
+    case Epiphany::ADD16ri:
+    case Epiphany::ADD32ri:
+      Sign = 1;
+      break;
+    case Epiphany::SUB16ri:
+    case Epiphany::SUB32ri:
+      Sign = -1;
+      break;
+    default:
+      return false;
+  }
+  if (!MI.getOperand(1).isReg() || !MI.getOperand(2).isImm()) {
+    return false;
+  }
+  Step = Sign * MI.getOperand(2).getImm();
+  return true;
+}
+
+namespace {
+  // Control of the single block loop "sub Flag, IV, Bound; b<cc> Loop",
+  // where IV is either the header PHI or its add/sub immediate update
+  struct LoopControl {
+    MachineInstr *Branch;
+    MachineInstr *Cmp;
+    MachineInstr *Update;
+    unsigned IVOpIdx;
+    unsigned InitReg;
+    int64_t Step;
+    bool IsNext;
+  };
+}
+
+static bool getLoopControl(MachineBasicBlock &MBB, const MachineRegisterInfo &MRI,
+    LoopControl &LC) {
+  // Loop should continue on the conditional branch
+  LC.Branch = nullptr;
+  for (MachineInstr &MI : MBB.terminators()) {
+    if (MI.getOpcode() == Epiphany::BCC32 && MI.getOperand(0).getMBB() == &MBB) {
+      LC.Branch = &MI;
+    }
+  }
+  if (!LC.Branch || !LC.Branch->getOperand(2).isReg() ||
+      !TargetRegisterInfo::isVirtualRegister(LC.Branch->getOperand(2).getReg())) {
+    return false;
+  }
+
+  LC.Cmp = MRI.getVRegDef(LC.Branch->getOperand(2).getReg());
+  if (!LC.Cmp || LC.Cmp->getParent() != &MBB) {
+    return false;
+  }
+  switch (LC.Cmp->getOpcode()) {
+    case Epiphany::SUBrr_r16:
+    case Epiphany::SUBrr_r32:
+    case Epiphany::SUB16ri:
+    case Epiphany::SUB32ri:
+      break;
+    default:
+      return false;
+  }
+  for (MachineBasicBlock::iterator I = std::next(MachineBasicBlock::iterator(LC.Cmp)),
+      E(LC.Branch); I != E; ++I) {
+    if (I->definesRegister(Epiphany::STATUS)) {
+      return false;
+    }
+  }
+
+  // Find the compare operand that is the induction variable
+  for (unsigned i = 1; i < 3; ++i) {
+    const MachineOperand &MO = LC.Cmp->getOperand(i);
+    if (!MO.isReg() || !TargetRegisterInfo::isVirtualRegister(MO.getReg())) {
+      continue;
+    }
+    MachineInstr *Def = MRI.getVRegDef(MO.getReg());
+    if (!Def || Def->getParent() != &MBB) {
+      continue;
+    }
+    MachineInstr *Phi = Def;
+    LC.IsNext = !Def->isPHI();
+    if (LC.IsNext) {
+      if (!getAddImmStep(*Def, LC.Step) ||
+          !TargetRegisterInfo::isVirtualRegister(Def->getOperand(1).getReg())) {
+        continue;
+      }
+      Phi = MRI.getVRegDef(Def->getOperand(1).getReg());
+    }
+    if (!Phi || !Phi->isPHI() || Phi->getParent() != &MBB || Phi->getNumOperands() != 5) {
+      continue;
+    }
+
+    // PHI operands are (Rd, Val0, MBB0, Val1, MBB1)
+    unsigned UpdateReg = 0;
+    LC.InitReg = 0;
+    for (unsigned j = 1; j < 5; j += 2) {
+      if (Phi->getOperand(j + 1).getMBB() == &MBB) {
+        UpdateReg = Phi->getOperand(j).getReg();
+      } else {
+        LC.InitReg = Phi->getOperand(j).getReg();
+      }
+    }
+    if (!UpdateReg || !LC.InitReg) {
+      continue;
+    }
+    LC.Update = MRI.getVRegDef(UpdateReg);
+    if (!LC.Update || (LC.IsNext && LC.Update != Def) ||
+        !getAddImmStep(*LC.Update, LC.Step) ||
+        LC.Update->getOperand(1).getReg() != Phi->getOperand(0).getReg()) {
+      continue;
+    }
+    // New updates are made with 32-bit add/sub
+    if (LC.Step == 0 || !isInt<11>(LC.Step) || !isInt<11>(-LC.Step)) {
+      return false;
+    }
+    LC.IVOpIdx = i;
+
+    // Bound should be loop invariant and different from the initial value
+    const MachineOperand &Bound = LC.Cmp->getOperand(3 - i);
+    if (Bound.isReg()) {
+      MachineInstr *BoundDef = TargetRegisterInfo::isVirtualRegister(Bound.getReg()) ?
+        MRI.getVRegDef(Bound.getReg()) : nullptr;
+      if (!BoundDef || BoundDef->getParent() == &MBB || Bound.getReg() == LC.InitReg) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+bool EpiphanyInstrInfo::analyzeLoop(MachineLoop &L, MachineInstr *&IndVarInst,
+    MachineInstr *&CmpInst) const {
+  MachineBasicBlock *Header = L.getHeader();
+  if (L.getNumBlocks() != 1) {
+    return true;
+  }
+
+  LoopControl LC;
+  if (!getLoopControl(*Header, Header->getParent()->getRegInfo(), LC)) {
+    return true;
+  }
+  // Exit condition should exist
+  SmallVector<MachineOperand, 1> Cond;
+  Cond.push_back(LC.Branch->getOperand(1));
+  if (reverseBranchCondition(Cond)) {
+    return true;
+  }
+  // Flags are a single register, which the pipeliner doesn't rename, so the
+  // flags read by moves like MOVCC might come from another stage
+  for (MachineInstr &MI : *Header) {
+    if (&MI != LC.Branch && MI.readsRegister(Epiphany::STATUS)) {
+      return true;
+    }
+  }
+
+  IndVarInst = LC.Update;
+  CmpInst = LC.Cmp;
+  return false;
+}
+
+// Build "add/sub Rd, Rn, #step" for the induction variable
+static MachineInstr *buildStep(const EpiphanyInstrInfo &TII, MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I, const DebugLoc &DL, unsigned Rd, unsigned Rn,
+    int64_t Step) {
+  unsigned Opc = (Step > 0) ? Epiphany::ADD32ri : Epiphany::SUB32ri;
+  return BuildMI(MBB, I, DL, TII.get(Opc), Rd).addReg(Rn).addImm(std::abs(Step));
+}
+
+// Copy the loop compare, comparing Reg instead of the induction variable
+static MachineInstr *buildCompare(const EpiphanyInstrInfo &TII, MachineBasicBlock &MBB,
+    MachineBasicBlock::iterator I, const LoopControl &LC, unsigned Flag, unsigned Reg) {
+  MachineFunction &MF = *MBB.getParent();
+  MachineInstr *NewCmp = MF.CloneMachineInstr(LC.Cmp);
+  switch (NewCmp->getOpcode()) {
+    case Epiphany::SUBrr_r16:
+      NewCmp->setDesc(TII.get(Epiphany::SUBrr_r32));
+      break;
+    case Epiphany::SUB16ri:
+      NewCmp->setDesc(TII.get(Epiphany::SUB32ri));
+      break;
+  }
+  NewCmp->getOperand(0).setReg(Flag);
+  NewCmp->getOperand(LC.IVOpIdx).setReg(Reg);
+  NewCmp->clearKillInfo();
+  MBB.insert(I, NewCmp);
+  return NewCmp;
+}
+
+/// reduceLoopCount - The pipeliner calls this for every prolog block, from the
+/// last one (Iter == MaxIter) to the first (Iter == 0). Prolog Iter starts
+/// the loop iteration Iter, and branches to its epilog if that iteration is
+/// the last one. The induction variable of each iteration is rebuilt from the
+/// initial value, chained through PrevInsts like in the Hexagon backend.
+///
+/// The kernel starts iteration MaxIter + 1 on its first trip, and the loop
+/// compare may be scheduled to a later stage, so the kernel gets its own
+/// induction variable to test.
+unsigned EpiphanyInstrInfo::reduceLoopCount(MachineBasicBlock &MBB,
+    MachineInstr *IndVar, MachineInstr &Cmp, SmallVectorImpl<MachineOperand> &Cond,
+    SmallVectorImpl<MachineInstr *> &PrevInsts, unsigned Iter,
+    unsigned MaxIter) const {
+  MachineFunction &MF = *MBB.getParent();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  const TargetRegisterClass *RC = &Epiphany::GPR32RegClass;
+  DebugLoc DL = Cmp.getDebugLoc();
+
+  // The original loop is still in place
+  LoopControl LC;
+  bool IsLoop = getLoopControl(*Cmp.getParent(), MRI, LC);
+  assert(IsLoop && LC.Cmp == &Cmp && LC.Update == IndVar && "Loop is not analyzable");
+  (void)IsLoop;
+
+  // Variable before (InitReg) and after (Next) this iteration
+  unsigned Next = MRI.createVirtualRegister(RC);
+  MachineInstr *NewUpdate = buildStep(*this, MBB, MBB.end(), DL, Next, LC.InitReg, LC.Step);
+  unsigned Flag = MRI.createVirtualRegister(RC);
+  MachineInstr *NewCmp = buildCompare(*this, MBB, MBB.end(), LC, Flag, LC.IsNext ? Next : LC.InitReg);
+
+  // Prolog built for the next iteration starts where this one ends
+  for (MachineInstr *MI : PrevInsts) {
+    MI->substituteRegister(LC.InitReg, Next, 0, RI);
+  }
+  PrevInsts.clear();
+  PrevInsts.push_back(NewUpdate);
+  PrevInsts.push_back(NewCmp);
+
+  if (Iter == MaxIter) {
+    MachineBasicBlock *Kernel = nullptr;
+    for (MachineBasicBlock *Succ : MBB.successors()) {
+      if (Succ->isSuccessor(Succ)) {
+        Kernel = Succ;
+      }
+    }
+    assert(Kernel && "Kernel should follow the last prolog");
+
+    MachineBasicBlock::iterator Term = Kernel->getFirstTerminator();
+    assert(Term != Kernel->end() && Term->getOpcode() == Epiphany::BCC32 &&
+        "Kernel should end with conditional branch");
+
+    // Flags for the kernel branch are set by the copy of the loop compare
+    MachineInstr *OldCmp = nullptr;
+    for (MachineBasicBlock::iterator I = Term; I != Kernel->begin();) {
+      --I;
+      if (I->readsRegister(Epiphany::STATUS)) {
+        break;
+      }
+      if (I->definesRegister(Epiphany::STATUS)) {
+        if (I->getOpcode() == Cmp.getOpcode() && MRI.use_nodbg_empty(I->getOperand(0).getReg())) {
+          OldCmp = &*I;
+        }
+        break;
+      }
+    }
+
+    unsigned Var = MRI.createVirtualRegister(RC);
+    unsigned VarNext = MRI.createVirtualRegister(RC);
+    BuildMI(*Kernel, Kernel->begin(), DL, get(TargetOpcode::PHI), Var)
+      .addReg(Next).addMBB(&MBB)
+      .addReg(VarNext).addMBB(Kernel);
+    buildStep(*this, *Kernel, Term, DL, VarNext, Var, LC.Step);
+    unsigned KernelFlag = MRI.createVirtualRegister(RC);
+    buildCompare(*this, *Kernel, Term, LC, KernelFlag, LC.IsNext ? VarNext : Var);
+    Term->getOperand(2).setReg(KernelFlag);
+
+    if (OldCmp) {
+      OldCmp->eraseFromParent();
+    }
+  }
+
+  // Branch to the epilog when the loop exits
+  Cond.push_back(LC.Branch->getOperand(1));
+  reverseBranchCondition(Cond);
+  Cond.push_back(MachineOperand::CreateReg(Flag, false));
+  return Next;
+}
+
+bool EpiphanyInstrInfo::getBaseAndOffsetPosition(const MachineInstr &MI,
+    unsigned &BasePos, unsigned &OffsetPos) const {
+  if (!MI.mayLoad() && !MI.mayStore()) {
+    return false;
+  }
+
+  // Displacement forms are (Rd, Rn, imm), post-modify displacement forms are
+  // (Rd, Rn_wb, Rn, imm) for loads and (Rn_wb, Rd, Rn, imm) for stores
+  unsigned NumOps = MI.getNumExplicitOperands();
+  if (NumOps == 3) {
+    BasePos = 1;
+    OffsetPos = 2;
+  } else if (NumOps == 4) {
+    BasePos = 2;
+    OffsetPos = 3;
+  } else {
+    return false;
+  }
+  return MI.getOperand(BasePos).isReg() && MI.getOperand(OffsetPos).isImm();
+}
+
+bool EpiphanyInstrInfo::getMemOpBaseRegImmOfs(MachineInstr &LdSt,
+    unsigned &BaseReg, int64_t &Offset, const TargetRegisterInfo *TRI) const {
+  unsigned BasePos, OffsetPos;
+  if (!getBaseAndOffsetPosition(LdSt, BasePos, OffsetPos)) {
+    return false;
+  }
+  // Post-modify accesses use the base before the update
+  if (LdSt.getNumExplicitOperands() == 4) {
+    Offset = 0;
+  } else {
+    Offset = LdSt.getOperand(OffsetPos).getImm();
+  }
+  BaseReg = LdSt.getOperand(BasePos).getReg();
+  return true;
+}
+
+bool EpiphanyInstrInfo::getIncrementValue(const MachineInstr &MI, int &Value) const {
+  unsigned BasePos, OffsetPos;
+  if (getBaseAndOffsetPosition(MI, BasePos, OffsetPos)) {
+    if (MI.getNumExplicitOperands() != 4) {
+      return false;
+    }
+    Value = MI.getOperand(OffsetPos).getImm();
+    return true;
+  }
+
+  int64_t Step;
+  if (!getAddImmStep(MI, Step)) {
+    return false;
+  }
+  Value = Step;
+  return true;
+}
+
+// The pipeliner reserves resources through the DFA generated from the
+// itineraries
+DFAPacketizer *EpiphanyInstrInfo::CreateTargetScheduleState(
+    const TargetSubtargetInfo &STI) const {
+  const InstrItineraryData *II = STI.getInstrItineraryData();
+  return static_cast<const EpiphanySubtarget &>(STI).createDFAPacketizer(II);
+}
+
+//===----------------------------------------------------------------------===//
+// Machine combiner
+//===----------------------------------------------------------------------===//
+//
+// A reduction compiled to a chain of multiply-adds waits for the full FPU
+// latency on every link. The machine combiner takes the accumulator of the
+// root multiply-add off the critical path by splitting the chain into two
+// parallel ones, with the pattern IDs added by LLVM_Epiphany.patch:
+//
+//   EPIPHANY_MADD_ADD_AB: (A + B) + c*d   => A + (B + c*d)
+//   EPIPHANY_MADD_ADD_BA: (A + B) + c*d   => B + (A + c*d)
+//   EPIPHANY_MADD_MADD:   (A + a*b) + c*d => A + (a*b + c*d)
+//
+// The last one splits the inner multiply-add into FMUL+FADD, its result is
+// then matched by the first two on the next link of the chain. The combiner
+// accepts the new sequence when the machine model says it doesn't lengthen
+// the critical path, so the latencies decide which side is kept late.
+//
+// Integer multiply-adds are reassociated the same way, f32 only with
+// -ffast-math. New instructions use the 32-bit encoding, the compression
+// pass shortens them after register allocation.
+
+namespace {
+  struct MulAddOpcodes {
+    unsigned Add;
+    unsigned Mul;
+    unsigned MulAdd;
+  };
+}
+
+static const MulAddOpcodes FloatMulAdd = {
+  Epiphany::FADDrr_r32, Epiphany::FMULrr_r32, Epiphany::FMADDrr_r32
+};
+static const MulAddOpcodes IntMulAdd = {
+  Epiphany::ADDrr_r32, Epiphany::IMULrr_r32, Epiphany::IMADDrr_r32
+};
+
+static bool isFloatMulAdd(unsigned Opc) {
+  return Opc == Epiphany::FMADDrr_r16 || Opc == Epiphany::FMADDrr_r32;
+}
+
+static bool isIntMulAdd(unsigned Opc) {
+  return Opc == Epiphany::IMADDrr_r16 || Opc == Epiphany::IMADDrr_r32;
+}
+
+static bool isAddOpcode(unsigned Opc, bool IsFloat) {
+  if (IsFloat) {
+    return Opc == Epiphany::FADDrr_r16 || Opc == Epiphany::FADDrr_r32;
+  }
+  return Opc == Epiphany::ADDrr_r16  || Opc == Epiphany::ADDrr_r32 ||
+         Opc == Epiphany::IADDrr_r16 || Opc == Epiphany::IADDrr_r32;
+}
+
+// Changing the order of f32 operations changes rounding
+static bool canReassociate(const MachineInstr &MI, bool IsFloat) {
+  return !IsFloat || MI.getParent()->getParent()->getTarget().Options.UnsafeFPMath;
+}
+
+// Flags of the moved instructions must not be read by anyone
+static bool hasDeadStatus(const MachineInstr &MI) {
+  int Idx = MI.findRegisterDefOperandIdx(Epiphany::STATUS);
+  return Idx == -1 || MI.getOperand(Idx).isDead();
+}
+
+static void setDeadStatus(MachineInstr &MI) {
+  int Idx = MI.findRegisterDefOperandIdx(Epiphany::STATUS);
+  if (Idx != -1) {
+    MI.getOperand(Idx).setIsDead();
+  }
+}
+
+static bool hasVirtualRegUses(const MachineInstr &MI) {
+  for (unsigned i = 1, e = MI.getNumExplicitOperands(); i != e; ++i) {
+    const MachineOperand &MO = MI.getOperand(i);
+    if (!MO.isReg() || !TargetRegisterInfo::isVirtualRegister(MO.getReg())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EpiphanyInstrInfo::isAssociativeAndCommutative(
+    const MachineInstr &Inst) const {
+  switch (Inst.getOpcode()) {
+    case Epiphany::FADDrr_r16:
+    case Epiphany::FADDrr_r32:
+    case Epiphany::FMULrr_r16:
+    case Epiphany::FMULrr_r32:
+      return canReassociate(Inst, true);
+    default:
+      return false;
+  }
+}
+
+bool EpiphanyInstrInfo::hasReassociableOperands(const MachineInstr &Inst,
+    const MachineBasicBlock *MBB) const {
+  return hasDeadStatus(Inst) &&
+    TargetInstrInfo::hasReassociableOperands(Inst, MBB);
+}
+
+void EpiphanyInstrInfo::setSpecialOperandAttr(MachineInstr &OldMI1,
+    MachineInstr &OldMI2, MachineInstr &NewMI1, MachineInstr &NewMI2) const {
+  // Both old instructions had dead flags, see hasReassociableOperands
+  setDeadStatus(NewMI1);
+  setDeadStatus(NewMI2);
+}
+
+bool EpiphanyInstrInfo::getMachineCombinerPatterns(MachineInstr &Root,
+    SmallVectorImpl<MachineCombinerPattern> &Patterns) const {
+  unsigned Opc = Root.getOpcode();
+  bool IsFloat = isFloatMulAdd(Opc);
+  if (!IsFloat && !isIntMulAdd(Opc)) {
+    return TargetInstrInfo::getMachineCombinerPatterns(Root, Patterns);
+  }
+  if (!canReassociate(Root, IsFloat) || !hasDeadStatus(Root) ||
+      !hasVirtualRegUses(Root)) {
+    return false;
+  }
+
+  // The accumulator must be computed in this block for this root only
+  const MachineRegisterInfo &MRI = Root.getParent()->getParent()->getRegInfo();
+  unsigned Acc = Root.getOperand(1).getReg();
+  if (!MRI.hasOneNonDBGUse(Acc)) {
+    return false;
+  }
+  MachineInstr *Prev = MRI.getUniqueVRegDef(Acc);
+  if (!Prev || Prev->getParent() != Root.getParent() ||
+      !hasDeadStatus(*Prev) || !hasVirtualRegUses(*Prev)) {
+    return false;
+  }
+
+  unsigned PrevOpc = Prev->getOpcode();
+  if (isAddOpcode(PrevOpc, IsFloat)) {
+    Patterns.push_back(MachineCombinerPattern::EPIPHANY_MADD_ADD_AB);
+    Patterns.push_back(MachineCombinerPattern::EPIPHANY_MADD_ADD_BA);
+    return true;
+  }
+  if (IsFloat ? isFloatMulAdd(PrevOpc) : isIntMulAdd(PrevOpc)) {
+    Patterns.push_back(MachineCombinerPattern::EPIPHANY_MADD_MADD);
+    return true;
+  }
+  return false;
+}
+
+void EpiphanyInstrInfo::genAlternativeCodeSequence(MachineInstr &Root,
+    MachineCombinerPattern Pattern,
+    SmallVectorImpl<MachineInstr *> &InsInstrs,
+    SmallVectorImpl<MachineInstr *> &DelInstrs,
+    DenseMap<unsigned, unsigned> &InstrIdxForVirtReg) const {
+  unsigned Opc = Root.getOpcode();
+  if (!isFloatMulAdd(Opc) && !isIntMulAdd(Opc)) {
+    TargetInstrInfo::genAlternativeCodeSequence(Root, Pattern, InsInstrs,
+        DelInstrs, InstrIdxForVirtReg);
+    return;
+  }
+
+  MachineFunction &MF = *Root.getParent()->getParent();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  const MulAddOpcodes &Ops = isFloatMulAdd(Opc) ? FloatMulAdd : IntMulAdd;
+  const TargetRegisterClass *RC = MRI.getRegClass(Root.getOperand(0).getReg());
+  const DebugLoc &DL = Root.getDebugLoc();
+  MachineInstr *Prev = MRI.getUniqueVRegDef(Root.getOperand(1).getReg());
+  unsigned RegC = Root.getOperand(2).getReg();
+  unsigned RegD = Root.getOperand(3).getReg();
+
+  // Build the new chain (Inner) and find the operand left on the old one
+  unsigned Inner = MRI.createVirtualRegister(RC);
+  unsigned Late;
+  switch (Pattern) {
+    case MachineCombinerPattern::EPIPHANY_MADD_ADD_AB:
+    case MachineCombinerPattern::EPIPHANY_MADD_ADD_BA: {
+      bool KeepFirst = (Pattern == MachineCombinerPattern::EPIPHANY_MADD_ADD_AB);
+      Late = Prev->getOperand(KeepFirst ? 1 : 2).getReg();
+      unsigned Other = Prev->getOperand(KeepFirst ? 2 : 1).getReg();
+      MachineInstr *MulAdd = BuildMI(MF, DL, get(Ops.MulAdd), Inner)
+        .addReg(Other).addReg(RegC).addReg(RegD);
+      InstrIdxForVirtReg.insert(std::make_pair(Inner, InsInstrs.size()));
+      InsInstrs.push_back(MulAdd);
+      break;
+    }
+    case MachineCombinerPattern::EPIPHANY_MADD_MADD: {
+      Late = Prev->getOperand(1).getReg();
+      unsigned Product = MRI.createVirtualRegister(RC);
+      MachineInstr *Mul = BuildMI(MF, DL, get(Ops.Mul), Product)
+        .addReg(Prev->getOperand(2).getReg())
+        .addReg(Prev->getOperand(3).getReg());
+      InstrIdxForVirtReg.insert(std::make_pair(Product, InsInstrs.size()));
+      InsInstrs.push_back(Mul);
+      MachineInstr *MulAdd = BuildMI(MF, DL, get(Ops.MulAdd), Inner)
+        .addReg(Product).addReg(RegC).addReg(RegD);
+      InstrIdxForVirtReg.insert(std::make_pair(Inner, InsInstrs.size()));
+      InsInstrs.push_back(MulAdd);
+      break;
+    }
+    default:
+      llvm_unreachable("Unknown multiply-add pattern");
+  }
+
+  MachineInstr *Add = BuildMI(MF, DL, get(Ops.Add), Root.getOperand(0).getReg())
+    .addReg(Late).addReg(Inner);
+  InsInstrs.push_back(Add);
+
+  // Flags of the root and the previous instruction were dead
+  for (MachineInstr *MI : InsInstrs) {
+    setDeadStatus(*MI);
+  }
+  DelInstrs.push_back(Prev);
+  DelInstrs.push_back(&Root);
+}
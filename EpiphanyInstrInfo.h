@@ -43,7 +43,7 @@ namespace llvm {
     const EpiphanyRegisterInfo &getRegisterInfo() const;
 
     /// Return the number of bytes of code the specified instruction may be.
-    unsigned GetInstSizeInBytes(const MachineInstr &MI) const;
+    unsigned getInstSizeInBytes(const MachineInstr &MI) const override;
 
     bool expandPostRAPseudo(MachineInstr &MI) const override;
 
@@ -106,6 +106,35 @@ namespace llvm {
         const DebugLoc &DL, int *BytesAdded = nullptr) const override;
     bool reverseBranchCondition(SmallVectorImpl<MachineOperand> &Cond) const override;
 
+    // Branch relaxation
+    MachineBasicBlock *getBranchDestBlock(const MachineInstr &MI) const override;
+    bool isBranchOffsetInRange(unsigned BranchOpc, int64_t BrOffset) const override;
+    /// Insert the 32-bit branch, used when the short one is out of range
+    unsigned insertIndirectBranch(MachineBasicBlock &MBB,
+        MachineBasicBlock &NewDestBB, const DebugLoc &DL, int64_t BrOffset = 0,
+        RegScavenger *RS = nullptr) const override;
+
+    // Predication and selects
+    /// MOVcc is the only predicated instruction
+    bool isPredicated(const MachineInstr &MI) const override;
+    /// Turn a register move into MOVcc
+    bool PredicateInstruction(MachineInstr &MI,
+        ArrayRef<MachineOperand> Pred) const override;
+    /// Compare the predicated cost with the taken branch penalty
+    bool isProfitableToIfCvt(MachineBasicBlock &MBB, unsigned NumCycles,
+        unsigned ExtraPredCycles, BranchProbability Probability) const override;
+    bool isProfitableToIfCvt(MachineBasicBlock &TMBB, unsigned NumTCycles,
+        unsigned ExtraTCycles, MachineBasicBlock &FMBB, unsigned NumFCycles,
+        unsigned ExtraFCycles, BranchProbability Probability) const override;
+    bool isProfitableToDupForIfCvt(MachineBasicBlock &MBB, unsigned NumCycles,
+        BranchProbability Probability) const override;
+    bool canInsertSelect(const MachineBasicBlock &MBB,
+        ArrayRef<MachineOperand> Cond, unsigned TrueReg, unsigned FalseReg,
+        int &CondCycles, int &TrueCycles, int &FalseCycles) const override;
+    void insertSelect(MachineBasicBlock &MBB, MachineBasicBlock::iterator I,
+        const DebugLoc &DL, unsigned DstReg, ArrayRef<MachineOperand> Cond,
+        unsigned TrueReg, unsigned FalseReg) const override;
+
     // Misc
     void insertNoop(MachineBasicBlock &MBB, MachineBasicBlock::iterator MI) const override;
     /// Test if the given instruction should be considered a scheduling boundary.
@@ -113,8 +142,55 @@ namespace llvm {
     bool isSchedulingBoundary(const MachineInstr &MI,
         const MachineBasicBlock *MBB, const MachineFunction &MF) const override;
 
+    // 16-bit forms
+    /// Check if the opcode has a 16-bit encoding
+    bool hasShortForm(unsigned Opc) const;
+    /// Get 16-bit opcode if the operands of MI fit the short encoding, 0 if not
+    unsigned getShortOpcode(const MachineInstr &MI) const;
+    /// Hardware loop bodies are kept in 32-bit encoding
+    bool isHardwareLoopBody(const MachineBasicBlock &MBB) const;
+
+    // Software pipelining
+    /// Get the induction variable update and the compare closing single
+    /// block loop. Returns true if the loop can't be analyzed.
+    bool analyzeLoop(MachineLoop &L, MachineInstr *&IndVarInst,
+        MachineInstr *&CmpInst) const override;
+    /// Add the exit check of the pipelined loop prolog MBB, see the
+    /// implementation for details
+    unsigned reduceLoopCount(MachineBasicBlock &MBB, MachineInstr *IndVar,
+        MachineInstr &Cmp, SmallVectorImpl<MachineOperand> &Cond,
+        SmallVectorImpl<MachineInstr *> &PrevInsts, unsigned Iter,
+        unsigned MaxIter) const override;
+    bool getMemOpBaseRegImmOfs(MachineInstr &LdSt, unsigned &BaseReg,
+        int64_t &Offset, const TargetRegisterInfo *TRI) const override;
+    bool getBaseAndOffsetPosition(const MachineInstr &MI, unsigned &BasePos,
+        unsigned &OffsetPos) const override;
+    bool getIncrementValue(const MachineInstr &MI, int &Value) const override;
+    /// Resource model used by the pipeliner, built from the itineraries
+    DFAPacketizer *CreateTargetScheduleState(
+        const TargetSubtargetInfo &STI) const override;
+
+    // Machine combiner
+    bool useMachineCombiner() const override { return true; }
+    /// FADD and FMUL chains are reassociated with -ffast-math
+    bool isAssociativeAndCommutative(const MachineInstr &Inst) const override;
+    bool hasReassociableOperands(const MachineInstr &Inst,
+        const MachineBasicBlock *MBB) const override;
+    void setSpecialOperandAttr(MachineInstr &OldMI1, MachineInstr &OldMI2,
+        MachineInstr &NewMI1, MachineInstr &NewMI2) const override;
+    /// Multiply-add chains are split into parallel trees, see the
+    /// implementation for the patterns
+    bool getMachineCombinerPatterns(MachineInstr &Root,
+        SmallVectorImpl<MachineCombinerPattern> &Patterns) const override;
+    void genAlternativeCodeSequence(MachineInstr &Root,
+        MachineCombinerPattern Pattern,
+        SmallVectorImpl<MachineInstr *> &InsInstrs,
+        SmallVectorImpl<MachineInstr *> &DelInstrs,
+        DenseMap<unsigned, unsigned> &InstrIdxForVirtReg) const override;
+
     private:
     void expandRTS(MachineBasicBlock &MBB, MachineBasicBlock::iterator I) const;
+    void expandDMASTART(MachineBasicBlock &MBB, MachineBasicBlock::iterator I) const;
 
   };
 
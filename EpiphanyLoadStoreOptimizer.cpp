@@ -0,0 +1,433 @@
+//===-----------------EpiphanyLoadStoreOptimizer.cpp-----------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass optimizes loads and stores before register allocation.
+//
+//  Word accesses to consecutive offsets from the same base are merged into a
+//  single double word access on a register pair if the lower one is aligned
+//  to 8 bytes. Loads are merged at the position of the first load, stores at
+//  the position of the last store, so nothing that may alias is allowed
+//  in between.
+//
+//  Base update following a zero offset access (add/sub with immediate or
+//  register) is folded into the post-modify form of the access, if the old
+//  base value is not used afterwards.
+//
+
+#include "EpiphanyLoadStoreOptimizer.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "epiphany_ldst_opt"
+
+static cl::opt<bool> DisableLoadStoreOpt("disable-epiphany-ldst-opt",
+    cl::Hidden, cl::init(false), cl::desc("Disable Epiphany load/store optimization"));
+
+// Maximum number of instructions to look through for the pair
+static cl::opt<unsigned> PairSearchLimit("epiphany-ldst-pair-limit",
+    cl::Hidden, cl::init(8), cl::desc("Epiphany load/store pairing search limit"));
+
+STATISTIC(NumPaired,    "Number of word accesses merged into double word");
+STATISTIC(NumPostModify, "Number of base updates folded into post-modify");
+
+char EpiphanyLoadStoreOptimizer::ID = 0;
+
+// Displacement forms with their post-modify counterparts
+namespace {
+  struct LSOpcodes {
+    unsigned R16;
+    unsigned R32;
+    unsigned Pmd;
+    unsigned PmAdd;
+    unsigned PmSub;
+    unsigned Size;
+  };
+}
+
+#define LS_OPCODES(Name, Size) \
+  { Epiphany::Name##_r16, Epiphany::Name##_r32, Epiphany::Name##_pmd_r32, \
+    Epiphany::Name##_pm_add_r32, Epiphany::Name##_pm_sub_r32, Size }
+
+static const LSOpcodes LSTable[] = {
+  LS_OPCODES(LDRi8,   1),
+  LS_OPCODES(LDRi8u,  1),
+  LS_OPCODES(LDRi8z,  1),
+  LS_OPCODES(LDRi16,  2),
+  LS_OPCODES(LDRi16u, 2),
+  LS_OPCODES(LDRi16z, 2),
+  LS_OPCODES(LDRi32,  4),
+  LS_OPCODES(STRi8,   1),
+  LS_OPCODES(STRi16,  2),
+  LS_OPCODES(STRi32,  4),
+  // No 16-bit double word forms
+  { 0, Epiphany::LDRi64_r32, Epiphany::LDRi64_pmd_r32,
+    Epiphany::LDRi64_pm_add_r32, Epiphany::LDRi64_pm_sub_r32, 8 },
+  { 0, Epiphany::STRi64_r32, Epiphany::STRi64_pmd_r32,
+    Epiphany::STRi64_pm_add_r32, Epiphany::STRi64_pm_sub_r32, 8 },
+};
+
+#undef LS_OPCODES
+
+static const LSOpcodes *getLSOpcodes(unsigned Opc) {
+  for (const LSOpcodes &Entry : LSTable) {
+    if (Entry.R32 == Opc || (Entry.R16 != 0 && Entry.R16 == Opc)) {
+      return &Entry;
+    }
+  }
+  return nullptr;
+}
+
+// Check if both accesses use the same base register or frame index
+static bool isSameBase(const MachineOperand &A, const MachineOperand &B) {
+  if (A.isReg() && B.isReg()) {
+    return A.getReg() == B.getReg();
+  }
+  if (A.isFI() && B.isFI()) {
+    return A.getIndex() == B.getIndex();
+  }
+  return false;
+}
+
+static void addBase(MachineInstrBuilder &MIB, const MachineOperand &Base) {
+  if (Base.isFI()) {
+    MIB.addFrameIndex(Base.getIndex());
+  } else {
+    MIB.addReg(Base.getReg());
+  }
+}
+
+// Get base update, i.e. add Rd, Rn, #imm or add Rd, Rn, Rm
+static bool getBaseUpdate(const MachineInstr &MI, unsigned Base, int64_t &Imm,
+    unsigned &IncReg, bool &IsSub) {
+  Imm = 0;
+  IncReg = 0;
+  IsSub = false;
+  switch (MI.getOpcode()) {
+    case Epiphany::ADD16ri:
+    case Epiphany::ADD32ri:
+    case Epiphany::SUB16ri:
+    case Epiphany::SUB32ri:
+      if (!MI.getOperand(1).isReg() || MI.getOperand(1).getReg() != Base || !MI.getOperand(2).isImm()) {
+        return false;
+      }
+      Imm = MI.getOperand(2).getImm();
+      if (MI.getOpcode() == Epiphany::SUB16ri || MI.getOpcode() == Epiphany::SUB32ri) {
+        Imm = -Imm;
+      }
+      return true;
+    case Epiphany::ADDrr_r16:
+    case Epiphany::ADDrr_r32:
+      if (MI.getOperand(1).getReg() == Base) {
+        IncReg = MI.getOperand(2).getReg();
+      } else if (MI.getOperand(2).getReg() == Base) {
+        IncReg = MI.getOperand(1).getReg();
+      }
+      break;
+    case Epiphany::SUBrr_r16:
+    case Epiphany::SUBrr_r32:
+      if (MI.getOperand(1).getReg() == Base) {
+        IncReg = MI.getOperand(2).getReg();
+      }
+      IsSub = true;
+      break;
+    default:
+      return false;
+  }
+  return IncReg != 0 && IncReg != Base && TargetRegisterInfo::isVirtualRegister(IncReg);
+}
+
+bool EpiphanyLoadStoreOptimizer::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableLoadStoreOpt || skipFunction(*MF.getFunction())) {
+    return false;
+  }
+
+  DEBUG(dbgs() << "\nRunning Epiphany load/store optimization pass\n");
+  TII = MF.getSubtarget<EpiphanySubtarget>().getInstrInfo();
+  MRI = &MF.getRegInfo();
+
+  // Pair first, so that merged accesses can be post-modified too
+  bool Changed = false;
+  for (MachineBasicBlock &MBB : MF) {
+    Changed |= pairAccesses(MBB);
+    Changed |= foldBaseUpdates(MBB);
+  }
+
+  return Changed;
+}
+
+// Word access with virtual register value and known offset
+bool EpiphanyLoadStoreOptimizer::isPairCandidate(const MachineInstr &MI, bool IsLoad) const {
+  unsigned Opc = MI.getOpcode();
+  if (IsLoad && Opc != Epiphany::LDRi32_r16 && Opc != Epiphany::LDRi32_r32) {
+    return false;
+  }
+  if (!IsLoad && Opc != Epiphany::STRi32_r16 && Opc != Epiphany::STRi32_r32) {
+    return false;
+  }
+  if (!MI.hasOneMemOperand() || (*MI.memoperands_begin())->isVolatile()) {
+    return false;
+  }
+  const MachineOperand &Reg  = MI.getOperand(0);
+  const MachineOperand &Base = MI.getOperand(1);
+  return Reg.isReg() && TargetRegisterInfo::isVirtualRegister(Reg.getReg()) &&
+    (Base.isReg() || Base.isFI()) && MI.getOperand(2).isImm();
+}
+
+// Find the access to the adjacent word, stop on anything that may alias
+MachineInstr *EpiphanyLoadStoreOptimizer::findPair(MachineInstr *First) const {
+  bool IsLoad = First->mayLoad();
+  MachineBasicBlock *MBB = First->getParent();
+  int64_t FirstOffset = First->getOperand(2).getImm();
+  unsigned Count = 0;
+
+  for (MachineBasicBlock::iterator I = std::next(MachineBasicBlock::iterator(First)), E = MBB->end();
+      I != E && Count < PairSearchLimit; ++I) {
+    MachineInstr &MI = *I;
+    if (MI.isDebugValue()) {
+      continue;
+    }
+    ++Count;
+    if (MI.isCall() || MI.isTerminator() || MI.hasUnmodeledSideEffects()) {
+      return nullptr;
+    }
+
+    if (isPairCandidate(MI, IsLoad) && isSameBase(MI.getOperand(1), First->getOperand(1))) {
+      int64_t Offset = MI.getOperand(2).getImm();
+      MachineInstr *Lo = nullptr;
+      if (Offset == FirstOffset + 4) {
+        Lo = First;
+      } else if (Offset + 4 == FirstOffset) {
+        Lo = &MI;
+      }
+      if (Lo) {
+        // Double word offset is scaled by 8
+        int64_t LoOffset = Lo->getOperand(2).getImm();
+        if ((*Lo->memoperands_begin())->getAlignment() < 8 ||
+            LoOffset % 8 != 0 || !isInt<11>(LoOffset / 8)) {
+          return nullptr;
+        }
+        return &MI;
+      }
+    }
+
+    // Loads are moved up, stores are moved down
+    if (MI.mayStore() || (!IsLoad && MI.mayLoad())) {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+// Replace two word accesses with the double word one
+void EpiphanyLoadStoreOptimizer::mergePair(MachineInstr *First, MachineInstr *Second) {
+  MachineInstr *Lo = First;
+  MachineInstr *Hi = Second;
+  if (Lo->getOperand(2).getImm() > Hi->getOperand(2).getImm()) {
+    std::swap(Lo, Hi);
+  }
+  DEBUG(dbgs() << "Merging\n"; Lo->print(dbgs()); Hi->print(dbgs()));
+
+  MachineBasicBlock &MBB = *First->getParent();
+  MachineFunction &MF = *MBB.getParent();
+  DebugLoc DL = Lo->getDebugLoc();
+  MachineOperand Base = Lo->getOperand(1);
+  int64_t Offset = Lo->getOperand(2).getImm();
+  unsigned LoReg = Lo->getOperand(0).getReg();
+  unsigned HiReg = Hi->getOperand(0).getReg();
+  MachineMemOperand *MMO = MF.getMachineMemOperand(*Lo->memoperands_begin(), 0, 8);
+  unsigned Pair = MRI->createVirtualRegister(&Epiphany::GPR64RegClass);
+
+  if (First->mayLoad()) {
+    MachineInstrBuilder MIB = BuildMI(MBB, First, DL, TII->get(Epiphany::LDRi64_r32), Pair);
+    addBase(MIB, Base);
+    MIB.addImm(Offset).addMemOperand(MMO);
+    BuildMI(MBB, First, DL, TII->get(TargetOpcode::COPY), LoReg).addReg(Pair, 0, Epiphany::isub_lo);
+    BuildMI(MBB, First, DL, TII->get(TargetOpcode::COPY), HiReg).addReg(Pair, 0, Epiphany::isub_hi);
+  } else {
+    BuildMI(MBB, Second, DL, TII->get(TargetOpcode::REG_SEQUENCE), Pair)
+      .addReg(LoReg).addImm(Epiphany::isub_lo)
+      .addReg(HiReg).addImm(Epiphany::isub_hi);
+    MachineInstrBuilder MIB = BuildMI(MBB, Second, DL, TII->get(Epiphany::STRi64_r32))
+      .addReg(Pair, RegState::Kill);
+    addBase(MIB, Base);
+    MIB.addImm(Offset).addMemOperand(MMO);
+    // Values are now used at the position of the second store
+    MRI->clearKillFlags(LoReg);
+    MRI->clearKillFlags(HiReg);
+  }
+  if (Base.isReg()) {
+    MRI->clearKillFlags(Base.getReg());
+  }
+
+  First->eraseFromParent();
+  Second->eraseFromParent();
+  ++NumPaired;
+}
+
+bool EpiphanyLoadStoreOptimizer::pairAccesses(MachineBasicBlock &MBB) {
+  bool Changed = false;
+  MachineBasicBlock::iterator I = MBB.begin();
+  while (I != MBB.end()) {
+    MachineInstr *First = &*I;
+    ++I;
+    if (!isPairCandidate(*First, First->mayLoad())) {
+      continue;
+    }
+    MachineInstr *Second = findPair(First);
+    if (!Second) {
+      continue;
+    }
+    if (I == MachineBasicBlock::iterator(Second)) {
+      ++I;
+    }
+    mergePair(First, Second);
+    Changed = true;
+  }
+  return Changed;
+}
+
+// Find base update of the zero offset access, old base should be dead after it
+MachineInstr *EpiphanyLoadStoreOptimizer::findBaseUpdate(MachineInstr *MI) const {
+  if (!getLSOpcodes(MI->getOpcode()) || !MI->getOperand(1).isReg() ||
+      !MI->getOperand(2).isImm() || MI->getOperand(2).getImm() != 0) {
+    return nullptr;
+  }
+  unsigned Base = MI->getOperand(1).getReg();
+  if (!TargetRegisterInfo::isVirtualRegister(Base)) {
+    return nullptr;
+  }
+  // Stored value can't be the base itself
+  if (MI->mayStore() && MI->getOperand(0).getReg() == Base) {
+    return nullptr;
+  }
+
+  MachineBasicBlock *MBB = MI->getParent();
+  for (MachineInstr &UseMI : MRI->use_nodbg_instructions(Base)) {
+    if (UseMI.getParent() != MBB) {
+      return nullptr;
+    }
+  }
+
+  // First use after the access should be the update and the last one
+  MachineInstr *Update = nullptr;
+  int64_t Imm;
+  unsigned IncReg;
+  bool IsSub;
+  for (MachineBasicBlock::iterator I = std::next(MachineBasicBlock::iterator(MI)), E = MBB->end();
+      I != E; ++I) {
+    if (I->isDebugValue() || !I->readsRegister(Base)) {
+      continue;
+    }
+    if (Update || !getBaseUpdate(*I, Base, Imm, IncReg, IsSub)) {
+      return nullptr;
+    }
+    Update = &*I;
+  }
+  if (!Update) {
+    return nullptr;
+  }
+
+  // Flags of the update can't be used
+  const MachineOperand *Status = Update->findRegisterDefOperand(Epiphany::STATUS);
+  if (Status && !Status->isDead()) {
+    return nullptr;
+  }
+
+  // Increment should be available at the access
+  if (IncReg) {
+    for (MachineBasicBlock::iterator I = MachineBasicBlock::iterator(MI);
+        I != MachineBasicBlock::iterator(Update); ++I) {
+      if (I->definesRegister(IncReg)) {
+        return nullptr;
+      }
+    }
+  }
+  return Update;
+}
+
+// Replace the access and base update with the post-modify access
+bool EpiphanyLoadStoreOptimizer::foldBaseUpdate(MachineInstr *MI, MachineInstr *Update) {
+  const LSOpcodes *LS = getLSOpcodes(MI->getOpcode());
+  unsigned Base = MI->getOperand(1).getReg();
+  int64_t Imm;
+  unsigned IncReg;
+  bool IsSub;
+  getBaseUpdate(*Update, Base, Imm, IncReg, IsSub);
+
+  unsigned Opc;
+  if (IncReg) {
+    Opc = IsSub ? LS->PmSub : LS->PmAdd;
+  } else {
+    // Post-modify displacement is scaled by the access size
+    if (Imm % LS->Size != 0 || !isInt<11>(Imm / LS->Size)) {
+      return false;
+    }
+    Opc = LS->Pmd;
+  }
+
+  unsigned NewBase = Update->getOperand(0).getReg();
+  if (!MRI->constrainRegClass(NewBase, &Epiphany::GPR32RegClass)) {
+    return false;
+  }
+  DEBUG(dbgs() << "Folding base update\n"; MI->print(dbgs()); Update->print(dbgs()));
+
+  MachineBasicBlock &MBB = *MI->getParent();
+  DebugLoc DL = MI->getDebugLoc();
+  const MachineOperand &Reg = MI->getOperand(0);
+  MachineInstrBuilder MIB;
+  if (MI->mayLoad()) {
+    MIB = BuildMI(MBB, MI, DL, TII->get(Opc), Reg.getReg())
+      .addReg(NewBase, RegState::Define)
+      .addReg(Base);
+  } else {
+    MIB = BuildMI(MBB, MI, DL, TII->get(Opc), NewBase)
+      .addReg(Reg.getReg(), getKillRegState(Reg.isKill()))
+      .addReg(Base);
+  }
+  if (IncReg) {
+    MIB.addReg(IncReg);
+    MRI->clearKillFlags(IncReg);
+  } else {
+    MIB.addImm(Imm);
+  }
+  MIB.setMemRefs(MI->memoperands_begin(), MI->memoperands_end());
+
+  MI->eraseFromParent();
+  Update->eraseFromParent();
+  ++NumPostModify;
+  return true;
+}
+
+bool EpiphanyLoadStoreOptimizer::foldBaseUpdates(MachineBasicBlock &MBB) {
+  bool Changed = false;
+  MachineBasicBlock::iterator I = MBB.begin();
+  while (I != MBB.end()) {
+    MachineInstr *MI = &*I;
+    ++I;
+    MachineInstr *Update = findBaseUpdate(MI);
+    if (!Update) {
+      continue;
+    }
+    MachineBasicBlock::iterator Next = I;
+    if (Next == MachineBasicBlock::iterator(Update)) {
+      ++Next;
+    }
+    if (foldBaseUpdate(MI, Update)) {
+      I = Next;
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+//===----------------------------------------------------------------------===//
+//                         Public Constructor Functions
+//===----------------------------------------------------------------------===//
+FunctionPass *llvm::createEpiphanyLoadStoreOptimizerPass() {
+  return new EpiphanyLoadStoreOptimizer();
+}
@@ -0,0 +1,57 @@
+//===-----------------EpiphanyLoadStoreOptimizer.h-------------------------===//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYLOADSTOREOPTIMIZER_H
+#define _LLVM_LIB_TARGET_EPIPHANY_EPIPHANYLOADSTOREOPTIMIZER_H
+
+#include "Epiphany.h"
+#include "EpiphanyConfig.h"
+#include "EpiphanySubtarget.h"
+#include "EpiphanyTargetMachine.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+
+namespace llvm {
+
+  class EpiphanyLoadStoreOptimizer : public MachineFunctionPass {
+
+    private:
+      const EpiphanyInstrInfo *TII;
+      MachineRegisterInfo *MRI;
+
+      bool isPairCandidate(const MachineInstr &MI, bool IsLoad) const;
+      MachineInstr *findPair(MachineInstr *First) const;
+      void mergePair(MachineInstr *First, MachineInstr *Second);
+      bool pairAccesses(MachineBasicBlock &MBB);
+
+      MachineInstr *findBaseUpdate(MachineInstr *MI) const;
+      bool foldBaseUpdate(MachineInstr *MI, MachineInstr *Update);
+      bool foldBaseUpdates(MachineBasicBlock &MBB);
+
+    public:
+      static char ID;
+      EpiphanyLoadStoreOptimizer() : MachineFunctionPass(ID) {}
+
+      StringRef getPassName() const {
+        return "Epiphany load/store optimization pass";
+      }
+      bool runOnMachineFunction(MachineFunction &MF);
+  };
+
+} // namespace llvm
+
+#endif
@@ -46,7 +46,7 @@ static void CreateMCInst(MCInst& Inst, unsigned Opc, const MCOperand& Opnd0,
 
 // @LowerOperand
 MCOperand EpiphanyMCInstLower::LowerOperand(const MachineOperand &MO,
-    unsigned Offset) const {
+    int64_t Offset) const {
   const MCSymbol *Symbol;
   MCSymbolRefExpr::VariantKind Kind = MCSymbolRefExpr::VK_None;
   EpiphanyMCExpr::EpiphanyExprKind TargetKind = EpiphanyMCExpr::CEK_None;
@@ -105,9 +105,8 @@ MCOperand EpiphanyMCInstLower::LowerOperand(const MachineOperand &MO,
       break;
  }
  const MCExpr *Expr = MCSymbolRefExpr::create(Symbol, Kind, *Ctx);
+  // Offsets folded into the address may be negative, e.g. for &a[-1]
   if (Offset) {
-    // Assume offset is never negative.
-    assert(Offset > 0);
     Expr = MCBinaryExpr::createAdd(Expr, MCConstantExpr::create(Offset, *Ctx), *Ctx);
   }
 
@@ -35,7 +35,7 @@ public:
   EpiphanyMCInstLower(EpiphanyAsmPrinter &asmprinter);
   void Initialize(MCContext* C);
   void Lower(const MachineInstr *MI, MCInst &OutMI) const;
-  MCOperand LowerOperand(const MachineOperand &MO, unsigned offset = 0) const;
+  MCOperand LowerOperand(const MachineOperand &MO, int64_t offset = 0) const;
 };
 
 } // namespace llvm
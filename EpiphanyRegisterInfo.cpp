@@ -18,6 +18,7 @@
 #include "Epiphany.h"
 #include "EpiphanySubtarget.h"
 #include "EpiphanyMachineFunction.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/CommandLine.h"
@@ -32,6 +33,10 @@ using namespace llvm;
 #define GET_REGINFO_TARGET_DESC
 #include "EpiphanyGenRegisterInfo.inc"
 
+static cl::opt<unsigned> ShortHintLimit("epiphany-short-hint-limit",
+    cl::Hidden, cl::init(4),
+    cl::desc("Maximum number of operands of the value hinted to R0-R7"));
+
 EpiphanyRegisterInfo::EpiphanyRegisterInfo(const EpiphanySubtarget &ST)
 	: EpiphanyGenRegisterInfo(Epiphany::LR), Subtarget(ST) {}
 
@@ -71,11 +76,52 @@ BitVector EpiphanyRegisterInfo::getReservedRegs(const MachineFunction &MF) const
 	Reserved.set(Epiphany::ZERO);
 
 	Reserved.set(Epiphany::STATUS);
+	Reserved.set(Epiphany::CONFIG);
+
+	// Base pointer, SB is kept for the small data
+	if (hasBasePointer(MF)) {
+		Reserved.set(getBaseRegister());
+	}
 
 	return Reserved;
 }
 
 
+// Short-lived values (few operands, all in one block) used only by
+// instructions having 16-bit forms are hinted to R0-R7, so that those can be
+// compressed after allocation. GPR32 allocation order puts R0-R8 last, so
+// the rest of the values don't compete for them.
+void EpiphanyRegisterInfo::getRegAllocationHints(unsigned VirtReg,
+    ArrayRef<MCPhysReg> Order, SmallVectorImpl<MCPhysReg> &Hints,
+    const MachineFunction &MF, const VirtRegMap *VRM) const {
+  TargetRegisterInfo::getRegAllocationHints(VirtReg, Order, Hints, MF, VRM);
+
+  const MachineRegisterInfo &MRI = MF.getRegInfo();
+  const EpiphanyInstrInfo *TII = Subtarget.getInstrInfo();
+  const MachineBasicBlock *MBB = nullptr;
+  unsigned NumOps = 0;
+  for (const MachineOperand &MO : MRI.reg_nodbg_operands(VirtReg)) {
+    const MachineInstr *MI = MO.getParent();
+    if ((MBB && MI->getParent() != MBB) || ++NumOps > ShortHintLimit) {
+      return;
+    }
+    if (!MI->isCopy() && !TII->hasShortForm(MI->getOpcode())) {
+      return;
+    }
+    MBB = MI->getParent();
+  }
+  if (!MBB || TII->isHardwareLoopBody(*MBB)) {
+    return;
+  }
+
+  for (MCPhysReg Reg : Order) {
+    if (Epiphany::GPR16RegClass.contains(Reg) &&
+        std::find(Hints.begin(), Hints.end(), Reg) == Hints.end()) {
+      Hints.push_back(Reg);
+    }
+  }
+}
+
 //- If no eliminateFrameIndex(), it will hang on run. 
 // pure virtual method
 // FrameIndex represent objects inside a abstract stack.
@@ -173,9 +219,9 @@ bool EpiphanyRegisterInfo::hasBasePointer(const MachineFunction &MF) const {
   return false;
 }
 
-// Returns stack base register
+// Returns stack base register, callee-saved and out of GPR16
 unsigned EpiphanyRegisterInfo::getBaseRegister() const { 
-  return Epiphany::SB; 
+  return Epiphany::R8; 
 }
 
 
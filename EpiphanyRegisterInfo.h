@@ -41,6 +41,11 @@ public:
                                        CallingConv::ID) const override;
 
   BitVector getReservedRegs(const MachineFunction &MF) const override;
+
+  void getRegAllocationHints(unsigned VirtReg, ArrayRef<MCPhysReg> Order,
+                             SmallVectorImpl<MCPhysReg> &Hints,
+                             const MachineFunction &MF,
+                             const VirtRegMap *VRM) const override;
   
   bool requiresRegisterScavenging(const MachineFunction &MF) const override;
   
@@ -37,7 +37,7 @@ using namespace llvm;
 static StringRef selectEpiphanyCPU(Triple TT, StringRef CPU) {
   if (CPU.empty() || CPU == "generic") {
     if (TT.getArch() == Triple::epiphany)
-      CPU = "epiphany";
+      CPU = "E16";
   }
   return CPU;
 }
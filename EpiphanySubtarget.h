@@ -97,6 +97,12 @@ public:
 
   bool enablePostRAScheduler() const override { return true; }
 
+  // Schedule with the E16 machine model before and after register allocation
+  bool enableMachineScheduler() const override { return true; }
+
+  // Branches over short blocks are replaced with MOVcc selects
+  bool enableEarlyIfConversion() const override { return true; }
+
 };
 } // End llvm namespace
 
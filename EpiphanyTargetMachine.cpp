@@ -19,15 +19,21 @@
 #include "EpiphanyISelDAGToDAG.h"
 #include "EpiphanySubtarget.h"
 #include "EpiphanyTargetObjectFile.h"
+#include "EpiphanyTargetTransformInfo.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/TargetRegistry.h"
 
 using namespace llvm;
 
 #define DEBUG_TYPE "epiphany"
 
+static cl::opt<bool> EnableMachineCombinerPass("epiphany-enable-mcr",
+    cl::Hidden, cl::init(true),
+    cl::desc("Enable the machine combiner pass"));
+
 extern "C" void LLVMInitializeEpiphanyTarget() {
   RegisterTargetMachine<EpiphanyTargetMachine> X(TheEpiphanyTarget);
 }
@@ -77,6 +83,11 @@ EpiphanyTargetMachine::EpiphanyTargetMachine(const Target &T, const Triple &TT,
         ABI(EpiphanyABIInfo::computeTargetABI()),
         Subtarget(TT, CPU, FS, *this) {
 
+  // Division and square root estimates are used with -ffast-math, two
+  // refinement steps are enough for most of the f32 precision
+  this->Options.Reciprocals.setDefaults("divf", true, 2);
+  this->Options.Reciprocals.setDefaults("sqrtf", true, 2);
+
   // initAsmInfo will display features by llc -march=cpu0 -mcpu=help on 3.7 but
   // not on 3.6
   initAsmInfo();
@@ -84,22 +95,33 @@ EpiphanyTargetMachine::EpiphanyTargetMachine(const Target &T, const Triple &TT,
 
 EpiphanyTargetMachine::~EpiphanyTargetMachine() {}
 
+TargetIRAnalysis EpiphanyTargetMachine::getTargetIRAnalysis() {
+  return TargetIRAnalysis([this](const Function &F) {
+    return TargetTransformInfo(EpiphanyTTIImpl(this, F));
+  });
+}
+
 namespace {
 //@EpiphanyPassConfig
 /// Epiphany Code Generator Pass Configuration Options.
 class EpiphanyPassConfig : public TargetPassConfig {
 public:
   EpiphanyPassConfig(EpiphanyTargetMachine *TM, PassManagerBase &PM)
-    : TargetPassConfig(TM, PM) {}
+    : TargetPassConfig(TM, PM) {
+    // Post-RA scheduling uses the dual issue machine model as well
+    substitutePass(&PostRASchedulerID, &PostMachineSchedulerID);
+  }
 
   EpiphanyTargetMachine &getEpiphanyTargetMachine() const {
     return getTM<EpiphanyTargetMachine>();
   }
 
+  void addIRPasses() override;
   bool addILPOpts() override;
   bool addInstSelector() override;
   void addPreRegAlloc() override;
   void addPreSched2() override;
+  void addPreEmitPass() override;
 
   const EpiphanySubtarget &getEpiphanySubtarget() const {
     return *getEpiphanyTargetMachine().getSubtargetImpl();
@@ -111,10 +133,17 @@ TargetPassConfig *EpiphanyTargetMachine::createPassConfig(PassManagerBase &PM) {
   return new EpiphanyPassConfig(this, PM);
 }
 
+void EpiphanyPassConfig::addIRPasses() {
+  TargetPassConfig::addIRPasses();
+  if (getOptLevel() != CodeGenOpt::None)
+    addPass(createEpiphanyArithModePass());
+}
+
 bool EpiphanyPassConfig::addILPOpts() {
   addPass(&EarlyIfConverterID);
-  //if (EnableMachineCombinerPass)
-    //addPass(&MachineCombinerID);
+  if (EnableMachineCombinerPass) {
+    addPass(&MachineCombinerID);
+  }
   return true;
 }
 
@@ -125,6 +154,15 @@ bool EpiphanyPassConfig::addInstSelector() {
 }
 
 void EpiphanyPassConfig::addPreRegAlloc() {
+  if (getOptLevel() != CodeGenOpt::None) {
+    // Pipeline loops while their compare and branch can still be analyzed,
+    // hardware loops replace them with LOOPEND
+    if (getOptLevel() >= CodeGenOpt::Default) {
+      addPass(&MachinePipelinerID);
+    }
+    addPass(createEpiphanyHardwareLoopsPass());
+    addPass(createEpiphanyLoadStoreOptimizerPass());
+  }
   addPass(&LiveVariablesID, false);
 }
 
@@ -132,3 +170,10 @@ void EpiphanyPassConfig::addPreSched2() {
   addPass(&IfConverterID, false);
 }
 
+void EpiphanyPassConfig::addPreEmitPass() {
+  if (getOptLevel() != CodeGenOpt::None) {
+    addPass(createEpiphanyInstrCompressionPass());
+    addPass(&BranchRelaxationPassID);
+  }
+}
+
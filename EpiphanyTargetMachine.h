@@ -48,6 +48,8 @@ public:
   };
 
   TargetPassConfig *createPassConfig(PassManagerBase &PM) override;
+
+  TargetIRAnalysis getTargetIRAnalysis() override;
   
   TargetLoweringObjectFile *getObjFileLowering() const override {
     return TLOF.get();
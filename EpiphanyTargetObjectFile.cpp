@@ -15,9 +15,12 @@
 
 #include "EpiphanySubtarget.h"
 #include "EpiphanyTargetMachine.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/Support/CommandLine.h"
@@ -26,6 +29,29 @@
 
 using namespace llvm;
 
+// SB has to be set up by the runtime, so small data stays opt-in
+static cl::opt<bool>
+UseSmallSection("epiphany-use-small-section", cl::Hidden, cl::init(false),
+    cl::desc("Place small globals in .sdata/.sbss and address them from SB"));
+
+static cl::opt<bool>
+ColdInExternal("epiphany-cold-in-external", cl::Hidden, cl::init(false),
+    cl::desc("Place cold functions into the external memory (.shared_dram.text)"));
+
+// Instruction fetch, data accesses and DMA to the same bank stall each other,
+// so large buffers can be moved out of the code bank
+static cl::opt<unsigned>
+DataBank("epiphany-data-bank", cl::Hidden, cl::init(0),
+    cl::desc("Local memory bank (1-3) for large data, 0 keeps default placement"));
+
+static cl::opt<unsigned>
+BankThreshold("epiphany-bank-threshold", cl::Hidden, cl::init(256),
+    cl::desc("Minimal size of data placed into -epiphany-data-bank (default=256)"));
+
+static cl::opt<unsigned>
+SSThreshold("epiphany-ssection-threshold", cl::Hidden, cl::init(8),
+    cl::desc("Small data and bss section threshold size (default=8)"));
+
 void EpiphanyTargetObjectFile::Initialize(MCContext &Ctx,
                                          const TargetMachine &TM) {
   TargetLoweringObjectFileELF::Initialize(Ctx, TM);
@@ -36,6 +62,158 @@ void EpiphanyTargetObjectFile::Initialize(MCContext &Ctx,
 
   SmallBSSSection = getContext().getELFSection(
       ".sbss", ELF::SHT_NOBITS, ELF::SHF_WRITE | ELF::SHF_ALLOC);
+
+  ExternalTextSection = getContext().getELFSection(
+      ".shared_dram.text", ELF::SHT_PROGBITS, ELF::SHF_ALLOC | ELF::SHF_EXECINSTR);
+
+  // Bank sections as named by the e-lib linker scripts
+  for (unsigned i = 0; i < array_lengthof(DataBankSections); ++i) {
+    DataBankSections[i] = getContext().getELFSection(
+        ".data_bank" + Twine(i), ELF::SHT_PROGBITS, ELF::SHF_WRITE | ELF::SHF_ALLOC);
+  }
   
   this->TM = &static_cast<const EpiphanyTargetMachine &>(TM);
 }
+
+/// Return true if this global address should be placed into small data
+/// section and addressed relative to SB.
+bool EpiphanyTargetObjectFile::
+IsGlobalInSmallSection(const GlobalObject *GO, const TargetMachine &TM) const {
+  // Only global variables, not functions.
+  const GlobalVariable *GVA = dyn_cast<GlobalVariable>(GO);
+  if (!GVA) {
+    return false;
+  }
+
+  // SB is only set up by the runtime when small data is asked for
+  if (!UseSmallSection) {
+    return false;
+  }
+
+  // Explicitly placed small data is addressed from SB, even when it is only
+  // declared in this module.
+  if (GVA->hasSection()) {
+    StringRef Section = GVA->getSection();
+    return Section == ".sdata" || Section == ".sbss";
+  }
+
+  if (GO->isDeclaration()) {
+    return false;
+  }
+
+  return IsGlobalInSmallSectionImpl(GO, TM);
+}
+
+/// Return true if this global definition is small enough and of the right
+/// kind to live in .sdata/.sbss.
+bool EpiphanyTargetObjectFile::
+IsGlobalInSmallSectionImpl(const GlobalObject *GO,
+                           const TargetMachine &TM) const {
+  if (!UseSmallSection) {
+    return false;
+  }
+
+  // Common symbols are allocated by the linker and TLS has its own sections.
+  const GlobalVariable *GVA = cast<GlobalVariable>(GO);
+  if (GVA->hasCommonLinkage() || GVA->isThreadLocal()) {
+    return false;
+  }
+
+  SectionKind Kind = getKindForGlobal(GO, TM);
+  if (!Kind.isData() && !Kind.isBSS() && !Kind.isReadOnly()) {
+    return false;
+  }
+  if (Kind.isMergeableConst() || Kind.isMergeableCString()) {
+    return false;
+  }
+
+  Type *Ty = GVA->getValueType();
+  return IsInSmallSection(GO->getParent()->getDataLayout().getTypeAllocSize(Ty));
+}
+
+bool EpiphanyTargetObjectFile::IsInSmallSection(uint64_t Size) const {
+  return Size > 0 && Size <= SSThreshold;
+}
+
+/// Return true if this global is known to live in the 32KB core-local
+/// memory, so its address fits into 16 bits.
+bool EpiphanyTargetObjectFile::
+IsGlobalInLocalMemory(const GlobalObject *GO, const TargetMachine &TM) const {
+  if (IsGlobalInExternalMemory(GO, TM)) {
+    return false;
+  }
+
+  // Sections of the core-local banks in the e-lib linker scripts
+  if (GO->hasSection()) {
+    StringRef Section = GO->getSection();
+    return Section.startswith(".text_bank") || Section.startswith(".data_bank");
+  }
+  if (getDataBank(GO, TM)) {
+    return true;
+  }
+
+  // Small code model means the whole program fits into local memory
+  return TM.getCodeModel() == CodeModel::Small;
+}
+
+/// Return true if this global is placed into the shared DRAM window.
+bool EpiphanyTargetObjectFile::
+IsGlobalInExternalMemory(const GlobalObject *GO, const TargetMachine &TM) const {
+  if (GO->hasSection()) {
+    return GO->getSection().startswith(".shared_dram");
+  }
+
+  const Function *F = dyn_cast<Function>(GO);
+  return ColdInExternal && F && F->hasFnAttribute(Attribute::Cold);
+}
+
+/// Return the bank a large data definition is moved to, 0 if it stays in the
+/// default data section.
+unsigned EpiphanyTargetObjectFile::
+getDataBank(const GlobalObject *GO, const TargetMachine &TM) const {
+  if (DataBank == 0 || DataBank >= array_lengthof(DataBankSections)) {
+    return 0;
+  }
+
+  const GlobalVariable *GVA = dyn_cast<GlobalVariable>(GO);
+  if (!GVA || GVA->hasSection() || GVA->isDeclaration() ||
+      GVA->hasCommonLinkage() || GVA->isThreadLocal()) {
+    return 0;
+  }
+
+  // Bank sections are writable PROGBITS, read-only and zero initialized
+  // data keep their own sections
+  SectionKind Kind = getKindForGlobal(GO, TM);
+  if (!Kind.isData()) {
+    return 0;
+  }
+
+  // Buffers bigger than a bank would spill into the next one anyway
+  uint64_t Size = GO->getParent()->getDataLayout().getTypeAllocSize(GVA->getValueType());
+  if (Size < BankThreshold || Size > 8192) {
+    return 0;
+  }
+
+  return DataBank;
+}
+
+MCSection *EpiphanyTargetObjectFile::
+SelectSectionForGlobal(const GlobalObject *GO, SectionKind Kind,
+                       const TargetMachine &TM) const {
+  // Explicit sections are handled by the generic code, cold code may go to
+  // the external memory and everything else small goes to .sbss or .sdata.
+  if (!GO->hasSection() && Kind.isText() && IsGlobalInExternalMemory(GO, TM)) {
+    return ExternalTextSection;
+  }
+  if (!GO->hasSection() && IsGlobalInSmallSectionImpl(GO, TM)) {
+    if (Kind.isBSS()) {
+      return SmallBSSSection;
+    }
+    return SmallDataSection;
+  }
+  if (unsigned Bank = getDataBank(GO, TM)) {
+    return DataBankSections[Bank];
+  }
+
+  return TargetLoweringObjectFileELF::SelectSectionForGlobal(GO, Kind, TM);
+}
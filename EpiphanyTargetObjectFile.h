@@ -26,10 +26,35 @@ namespace llvm {
   class EpiphanyTargetObjectFile : public TargetLoweringObjectFileELF {
     MCSection *SmallDataSection;
     MCSection *SmallBSSSection;
+    MCSection *ExternalTextSection;
+    // Local memory consists of four 8KB banks, code is in bank 0
+    MCSection *DataBankSections[4];
     const EpiphanyTargetMachine *TM;
     
+    bool IsGlobalInSmallSectionImpl(const GlobalObject *GO,
+                                    const TargetMachine &TM) const;
+    bool IsInSmallSection(uint64_t Size) const;
+    unsigned getDataBank(const GlobalObject *GO, const TargetMachine &TM) const;
+
    public:
     void Initialize(MCContext &Ctx, const TargetMachine &TM) override;
+
+    /// Return true if this global address should be placed into small data
+    /// section and addressed relative to SB.
+    bool IsGlobalInSmallSection(const GlobalObject *GO,
+                                const TargetMachine &TM) const;
+
+    /// Return true if this global is known to live in the 32KB core-local
+    /// memory, so its address fits into 16 bits.
+    bool IsGlobalInLocalMemory(const GlobalObject *GO,
+                               const TargetMachine &TM) const;
+
+    /// Return true if this global is placed into the shared DRAM window.
+    bool IsGlobalInExternalMemory(const GlobalObject *GO,
+                                  const TargetMachine &TM) const;
+
+    MCSection *SelectSectionForGlobal(const GlobalObject *GO, SectionKind Kind,
+                                      const TargetMachine &TM) const override;
   };
 
 } // end namespace llvm
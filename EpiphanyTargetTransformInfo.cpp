@@ -0,0 +1,153 @@
+//===-- EpiphanyTargetTransformInfo.cpp - Epiphany specific TTI -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Epiphany cost model used by the middle end. The
+// numbers are rough estimates of the generated code: no integer divider, f64
+// done in soft-float library calls, f32 division refined from an estimate,
+// and a long FPU pipeline which unrolled loops can hide.
+//
+//===----------------------------------------------------------------------===//
+
+#include "EpiphanyTargetTransformInfo.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "epiphanytti"
+
+// Library call with the argument shuffling around it
+static const int LibCallCost = 20;
+// Magic number division, the high part of the product is built from halves
+static const int DivByConstCost = 8;
+// Reciprocal estimate with two Newton-Raphson refinement steps, only done
+// with unsafe math, otherwise it's a library call
+static const int FDivCost = 8;
+// IMUL is issued on FPU and may need the CONFIG mode switch
+static const int MulCost = 2;
+
+// Full unrolling limit, lower than the default to save the local memory
+static const unsigned UnrollThreshold = 100;
+// Size limit of the partially unrolled loop body
+static const unsigned PartialUnrollThreshold = 60;
+
+// Get the FPU result latency from the itineraries
+static unsigned getFpuLatency(const EpiphanySubtarget &STI) {
+  const InstrItineraryData *Itins = STI.getInstrItineraryData();
+  unsigned SchedClass =
+    STI.getInstrInfo()->get(Epiphany::FADDrr_r32).getSchedClass();
+  int DefCycle = Itins->getOperandCycle(SchedClass, 0);
+  int UseCycle = Itins->getOperandCycle(SchedClass, 1);
+  return (DefCycle > UseCycle) ? unsigned(DefCycle - UseCycle) : 1U;
+}
+
+unsigned EpiphanyTTIImpl::getOperationCost(unsigned Opcode, Type *Ty,
+    Type *OpTy) {
+  // Every f64 operation is a library call
+  bool IsDouble = Ty->isDoubleTy() || (OpTy && OpTy->isDoubleTy());
+  if (IsDouble) {
+    switch (Opcode) {
+      case Instruction::FAdd:
+      case Instruction::FSub:
+      case Instruction::FMul:
+      case Instruction::FDiv:
+      case Instruction::FRem:
+      case Instruction::FCmp:
+      case Instruction::FPToSI:
+      case Instruction::FPToUI:
+      case Instruction::SIToFP:
+      case Instruction::UIToFP:
+        return TTI::TCC_Expensive;
+      default:
+        break;
+    }
+  }
+  return BaseT::getOperationCost(Opcode, Ty, OpTy);
+}
+
+int EpiphanyTTIImpl::getArithmeticInstrCost(unsigned Opcode, Type *Ty,
+    TTI::OperandValueKind Opd1Info, TTI::OperandValueKind Opd2Info,
+    TTI::OperandValueProperties Opd1PropInfo,
+    TTI::OperandValueProperties Opd2PropInfo,
+    ArrayRef<const Value *> Args) {
+  if (Ty->isVectorTy()) {
+    return BaseT::getArithmeticInstrCost(Opcode, Ty, Opd1Info, Opd2Info,
+        Opd1PropInfo, Opd2PropInfo, Args);
+  }
+
+  if (Ty->isDoubleTy()) {
+    return LibCallCost;
+  }
+
+  switch (Opcode) {
+    case Instruction::SDiv:
+    case Instruction::UDiv:
+    case Instruction::SRem:
+    case Instruction::URem:
+      if (Opd2Info == TTI::OK_UniformConstantValue) {
+        // Signed division by power of two needs rounding toward zero
+        if (Opd2PropInfo == TTI::OP_PowerOf2) {
+          return (Opcode == Instruction::UDiv) ? 1 : 3;
+        }
+        return DivByConstCost;
+      }
+      return LibCallCost;
+    case Instruction::Mul:
+      return MulCost;
+    case Instruction::FDiv:
+      return TLI->getTargetMachine().Options.UnsafeFPMath ? FDivCost : LibCallCost;
+    case Instruction::FRem:
+      return LibCallCost;
+    default:
+      break;
+  }
+
+  return BaseT::getArithmeticInstrCost(Opcode, Ty, Opd1Info, Opd2Info,
+      Opd1PropInfo, Opd2PropInfo, Args);
+}
+
+// Loops doing FPU work are unrolled until there are enough independent FPU
+// ops to cover the latency, but not further: the local memory is shared
+// between the code and the data.
+void EpiphanyTTIImpl::getUnrollingPreferences(Loop *L,
+    TTI::UnrollingPreferences &UP) {
+  UP.Threshold = UnrollThreshold;
+
+  unsigned NumFPOps = 0;
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      // Unrolling around a call saves nothing and costs the code size
+      if (isa<CallInst>(I) || isa<InvokeInst>(I)) {
+        if (!isa<IntrinsicInst>(I)) {
+          return;
+        }
+      }
+      if (isa<BinaryOperator>(I) && I.getType()->isFloatTy()) {
+        ++NumFPOps;
+      }
+    }
+  }
+  if (NumFPOps == 0) {
+    return;
+  }
+
+  unsigned Count = alignTo(getFpuLatency(*ST), NumFPOps) / NumFPOps;
+  if (Count <= 1) {
+    return;
+  }
+
+  DEBUG(dbgs() << "Unrolling FPU loop " << L->getHeader()->getName()
+      << " up to " << Count << " times\n");
+  UP.Partial = true;
+  UP.Runtime = true;
+  UP.PartialThreshold = PartialUnrollThreshold;
+  UP.MaxCount = Count;
+}
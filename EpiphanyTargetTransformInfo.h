@@ -0,0 +1,61 @@
+//===-- EpiphanyTargetTransformInfo.h - Epiphany specific TTI ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the Epiphany TargetTransformInfo, which describes the
+// cost of IR operations to the middle end passes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TARGET_EPIPHANY_TARGETTRANSFORMINFO_H
+#define LLVM_TARGET_EPIPHANY_TARGETTRANSFORMINFO_H
+
+#include "EpiphanyConfig.h"
+
+#include "EpiphanySubtarget.h"
+#include "EpiphanyTargetMachine.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/CodeGen/BasicTTIImpl.h"
+#include "llvm/Target/TargetLowering.h"
+
+namespace llvm {
+
+  class EpiphanyTTIImpl : public BasicTTIImplBase<EpiphanyTTIImpl> {
+    typedef BasicTTIImplBase<EpiphanyTTIImpl> BaseT;
+    typedef TargetTransformInfo TTI;
+    friend BaseT;
+
+    const EpiphanySubtarget *ST;
+    const EpiphanyTargetLowering *TLI;
+
+    const EpiphanySubtarget *getST() const { return ST; }
+    const EpiphanyTargetLowering *getTLI() const { return TLI; }
+
+    public:
+    explicit EpiphanyTTIImpl(const EpiphanyTargetMachine *TM, const Function &F)
+      : BaseT(TM, F.getParent()->getDataLayout()),
+      ST(TM->getSubtargetImpl(F)), TLI(ST->getTargetLowering()) {}
+
+    // Size of the IR operation, used by the unroller to estimate loop size
+    unsigned getOperationCost(unsigned Opcode, Type *Ty, Type *OpTy);
+
+    // Throughput of the arithmetic, used by the vectorizers and SimplifyCFG
+    int getArithmeticInstrCost(unsigned Opcode, Type *Ty,
+        TTI::OperandValueKind Opd1Info = TTI::OK_AnyValue,
+        TTI::OperandValueKind Opd2Info = TTI::OK_AnyValue,
+        TTI::OperandValueProperties Opd1PropInfo = TTI::OP_None,
+        TTI::OperandValueProperties Opd2PropInfo = TTI::OP_None,
+        ArrayRef<const Value *> Args = ArrayRef<const Value *>());
+
+    // Partial and runtime unrolling of FPU loops
+    void getUnrollingPreferences(Loop *L, TTI::UnrollingPreferences &UP);
+  };
+
+} // namespace llvm
+
+#endif // LLVM_TARGET_EPIPHANY_TARGETTRANSFORMINFO_H
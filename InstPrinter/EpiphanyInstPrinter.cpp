@@ -37,18 +37,67 @@ static unsigned getShift(unsigned int OpCode) {
     case Epiphany::STRi16_r16:
     case Epiphany::LDRi16_r32:
     case Epiphany::STRi16_r32:
+    case Epiphany::LDRi16_idx_add_r16:
+    case Epiphany::STRi16_idx_add_r16:
+    case Epiphany::LDRi16_idx_add_r32:
+    case Epiphany::STRi16_idx_add_r32:
+    case Epiphany::LDRi16_idx_sub_r32:
+    case Epiphany::STRi16_idx_sub_r32:
+    case Epiphany::LDRi16_pm_add_r16:
+    case Epiphany::STRi16_pm_add_r16:
+    case Epiphany::LDRi16_pm_add_r32:
+    case Epiphany::STRi16_pm_add_r32:
+    case Epiphany::LDRi16_pm_sub_r32:
+    case Epiphany::STRi16_pm_sub_r32:
+    case Epiphany::LDRi16_pmd_r32:
+    case Epiphany::STRi16_pmd_r32:
       Shift = 1;
+      break;
     case Epiphany::LDRi32_r16:
     case Epiphany::STRi32_r16:
     case Epiphany::LDRi32_r32:
     case Epiphany::STRi32_r32:
+    case Epiphany::LDRi32_idx_add_r16:
+    case Epiphany::STRi32_idx_add_r16:
+    case Epiphany::LDRi32_idx_add_r32:
+    case Epiphany::STRi32_idx_add_r32:
+    case Epiphany::LDRi32_idx_sub_r32:
+    case Epiphany::STRi32_idx_sub_r32:
+    case Epiphany::LDRi32_pm_add_r16:
+    case Epiphany::STRi32_pm_add_r16:
+    case Epiphany::LDRi32_pm_add_r32:
+    case Epiphany::STRi32_pm_add_r32:
+    case Epiphany::LDRi32_pm_sub_r32:
+    case Epiphany::STRi32_pm_sub_r32:
+    case Epiphany::LDRi32_pmd_r32:
+    case Epiphany::STRi32_pmd_r32:
+    case Epiphany::LDRf32:
+    case Epiphany::STRf32:
       Shift = 2;
+      break;
+    case Epiphany::LDRi64_r32:
+    case Epiphany::STRi64_r32:
+    case Epiphany::LDRi64_idx_add_r32:
+    case Epiphany::STRi64_idx_add_r32:
+    case Epiphany::LDRi64_idx_sub_r32:
+    case Epiphany::STRi64_idx_sub_r32:
+    case Epiphany::LDRi64_pm_add_r32:
+    case Epiphany::STRi64_pm_add_r32:
+    case Epiphany::LDRi64_pm_sub_r32:
+    case Epiphany::STRi64_pm_sub_r32:
+    case Epiphany::LDRi64_pmd_r32:
+    case Epiphany::STRi64_pmd_r32:
+      Shift = 3;
+      break;
   }
 
   return Shift;
 }
 
 void EpiphanyInstPrinter::printRegName(raw_ostream &OS, unsigned RegNo) const {
+  // Register pairs are named after the even register
+  if (unsigned Lo = MRI.getSubReg(RegNo, Epiphany::isub_lo))
+    RegNo = Lo;
   OS << StringRef(getRegisterName(RegNo)).lower();
 }
 
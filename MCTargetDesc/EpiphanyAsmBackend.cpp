@@ -27,6 +27,7 @@
 #include "llvm/MC/MCValue.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -53,9 +54,10 @@ static unsigned adjustFixupValue(const MCFixup &Fixup, uint64_t Value,
       DEBUG(dbgs() << "PCREL24 Value after adjust "; dbgs().write_hex(Value); dbgs() << "\n");
       break;
     case FK_Data_4:
+    case Epiphany::fixup_Epiphany_GPREL:
     case Epiphany::fixup_Epiphany_LOW:
-      // No adjustment for LOW
-      DEBUG(dbgs() << "LOW/32bit fixup "; dbgs().write_hex(Value); dbgs() << "\n");
+      // No adjustment for LOW, GPREL is placed by the size of the access
+      DEBUG(dbgs() << "LOW/GPREL/32bit fixup "; dbgs().write_hex(Value); dbgs() << "\n");
       break;
     case Epiphany::fixup_Epiphany_HIGH:
       // Get the higher 16-bits. Also add 1 if bit 15 is 1.
@@ -69,6 +71,17 @@ static unsigned adjustFixupValue(const MCFixup &Fixup, uint64_t Value,
 }
 //@adjustFixupValue }
 
+// Place a byte displacement into the sign-magnitude simm11 field of a 32-bit
+// load/store, scaled by the access size held in bits 6-5 of the instruction.
+// The object writer rejects it, as there's no relocation the linker knows.
+static uint64_t placeDisp11(uint64_t Insn, int64_t Disp) {
+  unsigned Shift = (Insn >> 5) & 0x3;
+  uint64_t Sign  = Disp < 0 ? 1 : 0;
+  uint64_t Mag   = ((Sign ? -Disp : Disp) >> Shift) & 0x7ff;
+
+  return ((Mag & 0x7) << 7) | (((Mag >> 3) & 0xff) << 16) | (Sign << 24);
+}
+
 MCObjectWriter *
 EpiphanyAsmBackend::createObjectWriter(raw_pwrite_stream &OS) const {
   return createEpiphanyELFObjectWriter(OS,
@@ -109,6 +122,11 @@ void EpiphanyAsmBackend::applyFixup(const MCFixup &Fixup, char *Data,
     CurVal |= (uint64_t)((uint8_t)Data[Offset + Idx]) << (i*8);
   }
 
+  // Displacement field is split and depends on the access size
+  if ((unsigned)Kind == Epiphany::fixup_Epiphany_GPREL) {
+    Value = placeDisp11(CurVal, (int32_t)Value);
+  }
+
   uint64_t Mask = ((uint64_t)(-1) >>
       (64 - getFixupKindInfo(Kind).TargetSize));
   CurVal |= Value & Mask;
@@ -132,7 +150,8 @@ getFixupKindInfo(MCFixupKind Kind) const {
     { "fixup_Epiphany_HIGH",           0,     16,   0 },
     { "fixup_Epiphany_LOW",            0,     16,   0 },
     { "fixup_Epiphany_SIMM8"  ,        0,     16,   MCFixupKindInfo::FKF_IsPCRel },
-    { "fixup_Epiphany_SIMM24",         0,     32,   MCFixupKindInfo::FKF_IsPCRel }
+    { "fixup_Epiphany_SIMM24",         0,     32,   MCFixupKindInfo::FKF_IsPCRel },
+    { "fixup_Epiphany_GPREL",          0,     32,   0 }
   };
 
   if (Kind < FirstTargetFixupKind)
@@ -144,6 +163,44 @@ getFixupKindInfo(MCFixupKind Kind) const {
 }
 //@getFixupKindInfo }
 
+// Get the 32-bit form of the relaxable 16-bit branch
+static unsigned getRelaxedOpcode(unsigned Opcode) {
+  switch (Opcode) {
+    default:
+      return Opcode;
+    case Epiphany::BNONE16:
+      return Epiphany::BNONE32;
+    case Epiphany::BCC16:
+      return Epiphany::BCC32;
+  }
+}
+
+bool EpiphanyAsmBackend::mayNeedRelaxation(const MCInst &Inst) const {
+  return getRelaxedOpcode(Inst.getOpcode()) != Inst.getOpcode();
+}
+
+/// fixupNeedsRelaxation - The 8-bit displacement is counted in half-words,
+/// so the branch reaches -256..254 bytes from its own address.
+bool EpiphanyAsmBackend::fixupNeedsRelaxation(const MCFixup &Fixup,
+    uint64_t Value, const MCRelaxableFragment *DF,
+    const MCAsmLayout &Layout) const {
+  if ((unsigned)Fixup.getKind() != Epiphany::fixup_Epiphany_SIMM8) {
+    return false;
+  }
+  return !isShiftedInt<8, 1>((int64_t)Value);
+}
+
+void EpiphanyAsmBackend::relaxInstruction(const MCInst &Inst,
+    const MCSubtargetInfo &STI, MCInst &Res) const {
+  unsigned RelaxedOpcode = getRelaxedOpcode(Inst.getOpcode());
+  assert(RelaxedOpcode != Inst.getOpcode() && "Unexpected instruction to relax");
+  DEBUG(dbgs() << "Relaxing 16-bit branch\n");
+
+  // Operand lists of both forms are the same
+  Res = Inst;
+  Res.setOpcode(RelaxedOpcode);
+}
+
 /// WriteNopData - Write an (optimal) nop sequence of Count bytes
 /// to the given output. If the target cannot generate such a sequence,
 /// it should return an error.
@@ -70,6 +70,11 @@ unsigned EpiphanyELFObjectWriter::getRelocType(MCContext &Ctx,
   case Epiphany::fixup_Epiphany_SIMM24:
     Type = ELF::R_EPIPHANY_SIMM24;
     break;
+  case Epiphany::fixup_Epiphany_GPREL:
+    // e-ld has no SB relative relocation, small data is assembly only
+    Ctx.reportError(Fixup.getLoc(),
+        "SB relative small data can't be relocated in object files");
+    break;
   }
 
   return Type;
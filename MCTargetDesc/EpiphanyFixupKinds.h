@@ -38,6 +38,9 @@ namespace llvm {
       fixup_Epiphany_SIMM8,
       fixup_Epiphany_SIMM24,
 
+      // SB relative load/store displacement, not relocatable in object files.
+      fixup_Epiphany_GPREL,
+
       // Marker
       LastTargetFixupKind,
       NumTargetFixupKinds = LastTargetFixupKind - FirstTargetFixupKind
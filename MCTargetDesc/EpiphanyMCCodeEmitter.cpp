@@ -110,6 +110,25 @@ unsigned EpiphanyMCCodeEmitter::getBranchTargetOpValue(const MCInst &MI, unsigne
   return 0;
 }
 
+/// getBranch16TargetOpValue - Return binary encoding of the 8-bit branch
+/// target operand. If the machine operand requires relocation,
+/// record the relocation and return zero.
+unsigned EpiphanyMCCodeEmitter::getBranch16TargetOpValue(const MCInst &MI, unsigned OpNo,
+    SmallVectorImpl<MCFixup> &Fixups,
+    const MCSubtargetInfo &STI) const {
+  const MCOperand &MO = MI.getOperand(OpNo);
+
+  if (MO.isImm()) {
+    return MO.getImm();
+  }
+
+  assert(MO.isExpr() && "Strange MO in getBranch16TargetOpValue");
+  const MCExpr *Expr = MO.getExpr();
+  MCFixupKind FixupKind = MCFixupKind(Epiphany::fixup_Epiphany_SIMM8);
+  Fixups.push_back(MCFixup::create(0, Expr, FixupKind));
+  return 0;
+}
+
 /// getJumpTargetOpValue - Return binary encoding of the jump target operand.
 /// If the machine operand requires relocation, record the relocation and return zero.
 //@getJumpTargetOpValue {
@@ -154,7 +173,7 @@ unsigned EpiphanyMCCodeEmitter::getExprOpValue(const MCExpr *Expr,SmallVectorImp
         FixupKind = Epiphany::fixup_Epiphany_LOW;
         break;
       case EpiphanyMCExpr::CEK_GPREL:
-        FixupKind = Epiphany::fixup_Epiphany_SIMM24;
+        FixupKind = Epiphany::fixup_Epiphany_GPREL;
         break;
     } // switch
     Fixups.push_back(MCFixup::create(0, Expr, MCFixupKind(FixupKind)));
@@ -207,6 +226,7 @@ static unsigned getShift(unsigned int OpCode) {
       case Epiphany::LDRi16_pmd_r32:
       case Epiphany::STRi16_pmd_r32:
         Shift = 1;
+        break;
       case Epiphany::LDRi32_r16:
       case Epiphany::STRi32_r16:
       case Epiphany::LDRi32_r32:
@@ -225,7 +245,24 @@ static unsigned getShift(unsigned int OpCode) {
       case Epiphany::STRi32_pm_sub_r32:
       case Epiphany::LDRi32_pmd_r32:
       case Epiphany::STRi32_pmd_r32:
+      case Epiphany::LDRf32:
+      case Epiphany::STRf32:
         Shift = 2;
+        break;
+      case Epiphany::LDRi64_r32:
+      case Epiphany::STRi64_r32:
+      case Epiphany::LDRi64_idx_add_r32:
+      case Epiphany::STRi64_idx_add_r32:
+      case Epiphany::LDRi64_idx_sub_r32:
+      case Epiphany::STRi64_idx_sub_r32:
+      case Epiphany::LDRi64_pm_add_r32:
+      case Epiphany::STRi64_pm_add_r32:
+      case Epiphany::LDRi64_pm_sub_r32:
+      case Epiphany::STRi64_pm_sub_r32:
+      case Epiphany::LDRi64_pmd_r32:
+      case Epiphany::STRi64_pmd_r32:
+        Shift = 3;
+        break;
     }
 
     return Shift;
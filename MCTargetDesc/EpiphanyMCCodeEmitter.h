@@ -66,6 +66,12 @@ namespace llvm {
         SmallVectorImpl<MCFixup> &Fixups,
         const MCSubtargetInfo &STI) const;
 
+    // getBranch16TargetOpValue - Same as above for the 8-bit displacement
+    // of the 16-bit branches.
+    unsigned getBranch16TargetOpValue(const MCInst &MI, unsigned OpNo,
+        SmallVectorImpl<MCFixup> &Fixups,
+        const MCSubtargetInfo &STI) const;
+
     // getJumpTargetOpValue - Return binary encoding of the jump
     // target operand, such as JSUB #function_addr. 
     // If the machine operand requires relocation,
@@ -55,6 +55,7 @@ void EpiphanyMCExpr::printImpl(raw_ostream &OS, const MCAsmInfo *MAI) const {
     OS << "%low";
     break;
   case CEK_GPREL:
+    OS << "%gprel";
     break;
   default:
     llvm_unreachable("Unknown kind: " + Kind);
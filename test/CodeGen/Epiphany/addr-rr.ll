@@ -0,0 +1,38 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; Base + index is a single load or store
+; CHECK-LABEL: load_byte:
+; CHECK-NOT: add
+; CHECK: ldrb r0, [r0,+r1]
+; CHECK: .Lfunc_end0:
+define i32 @load_byte(i8* nocapture readonly %p, i32 %i) {
+entry:
+  %addr = getelementptr inbounds i8, i8* %p, i32 %i
+  %v = load i8, i8* %addr, align 1
+  %ext = zext i8 %v to i32
+  ret i32 %ext
+}
+
+; Scaled index is shifted first
+; CHECK-LABEL: store_word:
+; CHECK: lsl [[IDX:r[0-9]+]], r1, #2
+; CHECK-NOT: add
+; CHECK: str r2, [r0,+[[IDX]]]
+; CHECK: .Lfunc_end1:
+define void @store_word(i32* nocapture %p, i32 %i, i32 %v) {
+entry:
+  %addr = getelementptr inbounds i32, i32* %p, i32 %i
+  store i32 %v, i32* %addr, align 4
+  ret void
+}
+
+; Constant offsets keep the displacement form
+; CHECK-LABEL: load_disp:
+; CHECK: ldr r0, [r0,#3]
+; CHECK: .Lfunc_end2:
+define i32 @load_disp(i32* nocapture readonly %p) {
+entry:
+  %addr = getelementptr inbounds i32, i32* %p, i32 3
+  %v = load i32, i32* %addr, align 4
+  ret i32 %v
+}
@@ -0,0 +1,51 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O1 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O1 -disable-epiphany-arith-mode-ipa < %s \
+; RUN:   | FileCheck %s --check-prefix=NOIPA
+
+; Internal callee is compiled first and entered in FPU mode, so it neither
+; switches nor saves CONFIG. Its caller switches once for both.
+; CHECK-LABEL: scale:
+; CHECK-NOT: config
+; CHECK: fmul
+; CHECK-NOT: config
+; CHECK: .Lfunc_end0:
+
+; CHECK-LABEL: caller:
+; CHECK: movts {{r[0-9]+}}, config
+; CHECK-NOT: config
+; CHECK: jalr {{r[0-9]+}}
+; CHECK-NOT: movts {{r[0-9]+}}, config
+; CHECK: fadd
+; CHECK: movts {{r[0-9]+}}, config
+; CHECK: .Lfunc_end1:
+
+; NOIPA-LABEL: caller:
+; NOIPA: .Lfunc_end0:
+; NOIPA-LABEL: scale:
+; NOIPA: movfs {{r[0-9]+}}, config
+; NOIPA: fmul
+; NOIPA: .Lfunc_end1:
+define float @caller(float %a, float %b) {
+entry:
+  %s = call float @scale(float %a)
+  %sum = fadd float %s, %b
+  ret float %sum
+}
+
+define internal float @scale(float %x) noinline {
+entry:
+  %m = fmul float %x, %x
+  ret float %m
+}
+
+; Address taken function may be called from anywhere
+; CHECK-LABEL: escaped:
+; CHECK: movfs {{r[0-9]+}}, config
+; CHECK: fmul
+define internal float @escaped(float %x) noinline {
+entry:
+  %m = fmul float %x, %x
+  ret float %m
+}
+
+@fptr = global float (float)* @escaped
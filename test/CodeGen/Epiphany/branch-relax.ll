@@ -0,0 +1,59 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -show-mc-encoding < %s | FileCheck %s
+
+; Near branch keeps the 16-bit encoding
+; CHECK-LABEL: near:
+; CHECK: b{{[a-z]+}} .LBB0_{{[0-9]+}} // encoding: [{{[^,]+}},{{[^,]+}}]{{$}}
+; CHECK: .Lfunc_end0:
+define void @near(i32 %a, i32* %p) {
+entry:
+  %c = icmp eq i32 %a, 0
+  br i1 %c, label %exit, label %then
+
+then:
+  store volatile i32 1, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
+
+; 100 inline asm lines are taken as 400 bytes, out of reach of the 16-bit
+; branch, which is made 32-bit again
+; CHECK-LABEL: far:
+; CHECK: b{{[a-z]+}} .LBB1_{{[0-9]+}} // encoding: [{{[^,]+}},{{[^,]+}},{{[^,]+}},{{[^,]+}}]{{$}}
+; CHECK: nop
+; CHECK: .Lfunc_end1:
+define void @far(i32 %a, i32* %p) {
+entry:
+  %c = icmp eq i32 %a, 0
+  br i1 %c, label %exit, label %then
+
+then:
+  call void asm sideeffect "nop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop", ""()
+  store volatile i32 1, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
+
+; Float less-than can't be reversed by the relaxation, it stays 32-bit
+; CHECK-LABEL: far_float:
+; CHECK: fsub
+; CHECK: bblt .LBB2_{{[0-9]+}} // encoding: [{{[^,]+}},{{[^,]+}},{{[^,]+}},{{[^,]+}}]{{$}}
+; CHECK-NOT: bbgte
+; CHECK: nop
+; CHECK: .Lfunc_end2:
+define void @far_float(float %a, float %b, i32* %p) {
+entry:
+  %c = fcmp olt float %a, %b
+  br i1 %c, label %then, label %exit
+
+then:
+  call void asm sideeffect "nop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop\0Anop", ""()
+  store volatile i32 1, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
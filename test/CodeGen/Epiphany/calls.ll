@@ -0,0 +1,70 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -epiphany-short-calls < %s \
+; RUN:   | FileCheck %s --check-prefix=SHORT
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -epiphany-short-calls \
+; RUN:   -epiphany-cold-in-external < %s | FileCheck %s --check-prefix=COLD
+
+declare void @ext()
+declare void @near() #0
+declare void @far() #1
+
+; The linker adds no veneers, calls go through a register by default
+; CHECK-LABEL: call_ext:
+; CHECK: mov [[R:r[0-9]+]], %low(ext)
+; CHECK: movt [[R]], %high(ext)
+; CHECK: jalr [[R]]
+; CHECK: .Lfunc_end0:
+; SHORT-LABEL: call_ext:
+; SHORT-NOT: jalr
+; SHORT: bl ext
+; SHORT: .Lfunc_end0:
+define void @call_ext() {
+entry:
+  call void @ext()
+  ret void
+}
+
+; CHECK-LABEL: call_near:
+; CHECK-NOT: jalr
+; CHECK: bl near
+; CHECK: .Lfunc_end1:
+define void @call_near() {
+entry:
+  call void @near()
+  ret void
+}
+
+; SHORT-LABEL: call_far:
+; SHORT: movt [[R:r[0-9]+]], %high(far)
+; SHORT: jalr [[R]]
+; SHORT: .Lfunc_end2:
+define void @call_far() {
+entry:
+  call void @far()
+  ret void
+}
+
+; Cold code goes to the external memory and is called through a register,
+; its own calls are long too
+; COLD-LABEL: call_cold:
+; COLD: movt [[R:r[0-9]+]], %high(cold)
+; COLD: jalr [[R]]
+; COLD: .Lfunc_end3:
+define void @call_cold() {
+entry:
+  call void @cold()
+  ret void
+}
+
+; COLD: .section .shared_dram.text
+; COLD-LABEL: {{^}}cold:
+; COLD: movt [[R:r[0-9]+]], %high(ext)
+; COLD: jalr [[R]]
+define void @cold() cold noinline {
+entry:
+  call void @ext()
+  ret void
+}
+
+attributes #0 = { "short-call" }
+attributes #1 = { "long-call" }
@@ -0,0 +1,87 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -show-mc-encoding < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -disable-epiphany-compression < %s \
+; RUN:   | FileCheck %s --check-prefix=NOCOMP
+
+; Operands in R0-R7 use the 16-bit encoding
+; CHECK-LABEL: add_rr:
+; CHECK: add r0, r0, r1 // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]{{$}}
+; CHECK: .Lfunc_end0:
+; NOCOMP-LABEL: add_rr:
+; NOCOMP: add.l r0, r0, r1
+; NOCOMP: .Lfunc_end0:
+define i32 @add_rr(i32 %a, i32 %b) {
+entry:
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; Immediate fits the 3-bit field
+; CHECK-LABEL: add_small_imm:
+; CHECK: add r0, r0, #3 // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]{{$}}
+; CHECK: .Lfunc_end1:
+define i32 @add_small_imm(i32 %a) {
+entry:
+  %r = add i32 %a, 3
+  ret i32 %r
+}
+
+; Immediate doesn't fit, stays 32-bit
+; CHECK-LABEL: add_large_imm:
+; CHECK: add r0, r0, #100 // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}},0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]
+; CHECK: .Lfunc_end2:
+define i32 @add_large_imm(i32 %a) {
+entry:
+  %r = add i32 %a, 100
+  ret i32 %r
+}
+
+; Displacement is scaled by the access size, [r0,#7] fits 3 bits
+; CHECK-LABEL: load_disp:
+; CHECK: ldr r0, [r0,#7] // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]{{$}}
+; CHECK: .Lfunc_end3:
+define i32 @load_disp(i32* %p) {
+entry:
+  %addr = getelementptr inbounds i32, i32* %p, i32 7
+  %v = load i32, i32* %addr, align 4
+  ret i32 %v
+}
+
+; CHECK-LABEL: load_far:
+; CHECK: ldr r0, [r0,#8] // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}},0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]
+; CHECK: .Lfunc_end4:
+define i32 @load_far(i32* %p) {
+entry:
+  %addr = getelementptr inbounds i32, i32* %p, i32 8
+  %v = load i32, i32* %addr, align 4
+  ret i32 %v
+}
+
+; Hardware loop body is kept in 32-bit instructions
+; CHECK-LABEL: loop_body:
+; CHECK: movts {{r[0-9]+}}, lc
+; CHECK: .p2align 3
+; CHECK-NEXT: .LBB5_{{[0-9]+}}:
+; CHECK-NOT: // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]{{$}}
+; CHECK: .p2align 3
+; CHECK-NEXT: .Lloop_end{{[0-9]+}}:
+; CHECK-NEXT: // encoding: [0x{{[0-9a-f]+}},0x{{[0-9a-f]+}},0x{{[0-9a-f]+}},0x{{[0-9a-f]+}}]
+; CHECK: .Lfunc_end5:
+define void @loop_body(i32* nocapture %a, i32* nocapture readonly %b, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr inbounds i32, i32* %b, i32 %i
+  %val = load i32, i32* %src, align 4
+  %sum = add nsw i32 %val, %n
+  %dst = getelementptr inbounds i32, i32* %a, i32 %i
+  store i32 %sum, i32* %dst, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
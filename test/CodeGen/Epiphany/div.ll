@@ -0,0 +1,88 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; Division by constant is a multiply by the magic number, the high half is
+; put together from 16x16 products
+; CHECK-LABEL: div_by_7:
+; CHECK-NOT: __divsi3
+; CHECK: imul
+; CHECK-NOT: __divsi3
+; CHECK: .Lfunc_end0:
+define i32 @div_by_7(i32 %x) {
+entry:
+  %q = sdiv i32 %x, 7
+  ret i32 %q
+}
+
+; CHECK-LABEL: urem_by_10:
+; CHECK-NOT: __umodsi3
+; CHECK: imul
+; CHECK-NOT: __umodsi3
+; CHECK: .Lfunc_end1:
+define i32 @urem_by_10(i32 %x) {
+entry:
+  %r = urem i32 %x, 10
+  ret i32 %r
+}
+
+; 16-bit operands are divided on FPU. FIX rounds to nearest, so the
+; numerator is biased towards zero: 7 / 2 is fix((2 * 7 + 1 - 2) / 4) =
+; fix(3.25) = 3, where fix(7.0 / 2.0) would round 3.5 up to 4.
+; CHECK-LABEL: sdiv_short:
+; CHECK-NOT: __divsi3
+; CHECK: lsl {{r[0-9]+}}, {{r[0-9]+}}, #1
+; CHECK: float
+; CHECK: fmsub
+; CHECK: fmadd
+; CHECK: fmul
+; CHECK: fix
+; CHECK-NOT: __divsi3
+; CHECK: .Lfunc_end2:
+define i32 @sdiv_short(i16 %a, i16 %b) {
+entry:
+  %a.ext = sext i16 %a to i32
+  %b.ext = sext i16 %b to i32
+  %q = sdiv i32 %a.ext, %b.ext
+  ret i32 %q
+}
+
+; The numerator of 7 / b is folded to 14 + 1 - |b|, b = 2 gives 3.25 too
+; CHECK-LABEL: udiv_7_short:
+; CHECK-NOT: __udivsi3
+; CHECK: sub{{(\.l)?}} {{r[0-9]+}}, {{r[0-9]+}}, {{r[0-9]+}}
+; CHECK: float
+; CHECK: fix
+; CHECK-NOT: __udivsi3
+; CHECK: .Lfunc_end3:
+define i32 @udiv_7_short(i16 %b) {
+entry:
+  %b.ext = zext i16 %b to i32
+  %q = udiv i32 7, %b.ext
+  ret i32 %q
+}
+
+; Remainder stays on FPU as well
+; CHECK-LABEL: urem_short:
+; CHECK-NOT: __umodsi3
+; CHECK: fix
+; CHECK: fsub
+; CHECK: fix
+; CHECK-NOT: __umodsi3
+; CHECK: .Lfunc_end4:
+define i32 @urem_short(i16 %a, i16 %b) {
+entry:
+  %a.ext = zext i16 %a to i32
+  %b.ext = zext i16 %b to i32
+  %r = urem i32 %a.ext, %b.ext
+  ret i32 %r
+}
+
+; Wider operands call the runtime library
+; CHECK-LABEL: sdiv_wide:
+; CHECK: __divsi3
+; CHECK-NOT: fix
+; CHECK: .Lfunc_end5:
+define i32 @sdiv_wide(i32 %a, i32 %b) {
+entry:
+  %q = sdiv i32 %a, %b
+  ret i32 %q
+}
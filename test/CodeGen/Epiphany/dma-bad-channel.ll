@@ -0,0 +1,18 @@
+; RUN: not llc -march=epiphany -mcpu=E16 -O2 < %s 2>&1 | FileCheck %s
+
+declare void @llvm.epiphany.dma.start(i32, i8*)
+declare void @llvm.epiphany.dma.wait(i32)
+
+; CHECK: error: {{.*}} in function bad_start void (i8*): DMA channel should be constant 0 or 1
+define void @bad_start(i8* %desc) {
+entry:
+  call void @llvm.epiphany.dma.start(i32 2, i8* %desc)
+  ret void
+}
+
+; CHECK: error: {{.*}} in function var_wait void (i32): DMA channel should be constant 0 or 1
+define void @var_wait(i32 %chan) {
+entry:
+  call void @llvm.epiphany.dma.wait(i32 %chan)
+  ret void
+}
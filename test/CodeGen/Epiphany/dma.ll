@@ -0,0 +1,54 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+declare void @llvm.epiphany.dma.start(i32, i8*)
+declare void @llvm.epiphany.dma.wait(i32)
+
+; Descriptor address goes to the upper half of the config with DMASTARTUP
+; CHECK-LABEL: start0:
+; CHECK: lsl [[C:r[0-9]+]], r0, #16
+; CHECK: add [[C2:r[0-9]+]], [[C]], #8
+; CHECK: movts [[C2]], dma0config
+; CHECK: .Lfunc_end0:
+define void @start0(i8* %desc) {
+entry:
+  call void @llvm.epiphany.dma.start(i32 0, i8* %desc)
+  ret void
+}
+
+; CHECK-LABEL: start1:
+; CHECK: movts {{r[0-9]+}}, dma1config
+; CHECK: .Lfunc_end1:
+define void @start1(i8* %desc) {
+entry:
+  call void @llvm.epiphany.dma.start(i32 1, i8* %desc)
+  ret void
+}
+
+; Status is polled until the channel is idle
+; CHECK-LABEL: wait1:
+; CHECK: [[LOOP:.Ltmp[0-9]+]]:
+; CHECK-NEXT: movfs [[S:r[0-9]+]], dma1status
+; CHECK-NEXT: lsl [[S]], [[S]], #28
+; CHECK-NEXT: bne [[LOOP]]
+; CHECK: .Lfunc_end2:
+define void @wait1() {
+entry:
+  call void @llvm.epiphany.dma.wait(i32 1)
+  ret void
+}
+
+; Loads and stores stay on their side of the start and the wait
+; CHECK-LABEL: transfer:
+; CHECK: str
+; CHECK: movts {{r[0-9]+}}, dma0config
+; CHECK: movfs {{r[0-9]+}}, dma0status
+; CHECK: ldr
+; CHECK: .Lfunc_end3:
+define i32 @transfer(i8* %desc, i32* %flag, i32* %buf) {
+entry:
+  store i32 1, i32* %flag, align 4
+  call void @llvm.epiphany.dma.start(i32 0, i8* %desc)
+  call void @llvm.epiphany.dma.wait(i32 0)
+  %v = load i32, i32* %buf, align 4
+  ret i32 %v
+}
@@ -0,0 +1,33 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -epiphany-dual-issue-comments < %s \
+; RUN:   | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s --check-prefix=NOCOMMENT
+
+; Integer and FPU instructions next to each other are paired
+; CHECK-LABEL: mixed:
+; CHECK: // dual issue
+; CHECK: // {{[1-9][0-9]*}} instruction pairs can be dual issued
+; CHECK: .Lfunc_end0:
+; NOCOMMENT-NOT: dual issue
+define float @mixed(float %a, float %b, i32 %x, i32* %p) {
+entry:
+  %s = fadd float %a, %b
+  %m = fmul float %s, %s
+  %x1 = xor i32 %x, 85
+  %x2 = add i32 %x1, %x
+  %x3 = shl i32 %x2, 3
+  store i32 %x3, i32* %p, align 4
+  ret float %m
+}
+
+; Integer instructions use the same issue slot
+; CHECK-LABEL: integer_only:
+; CHECK-NOT: // dual issue
+; CHECK: // 0 instruction pairs can be dual issued
+; CHECK: .Lfunc_end1:
+define i32 @integer_only(i32 %x, i32 %y) {
+entry:
+  %a = add i32 %x, %y
+  %b = xor i32 %a, %y
+  %c = shl i32 %b, 2
+  ret i32 %c
+}
@@ -0,0 +1,153 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+declare float @llvm.minnum.f32(float, float)
+declare float @llvm.maxnum.f32(float, float)
+
+; CHECK-LABEL: select_olt:
+; CHECK: fsub {{r[0-9]+}}, r0, r1
+; CHECK: movblt
+; CHECK: .Lfunc_end0:
+define i32 @select_olt(float %a, float %b, i32 %x, i32 %y) {
+entry:
+  %c = fcmp olt float %a, %b
+  %r = select i1 %c, i32 %x, i32 %y
+  ret i32 %r
+}
+
+; There's no greater-than float condition, the operands are swapped
+; CHECK-LABEL: select_ogt:
+; CHECK: fsub {{r[0-9]+}}, r1, r0
+; CHECK: movblt
+; CHECK: .Lfunc_end1:
+define i32 @select_ogt(float %a, float %b, i32 %x, i32 %y) {
+entry:
+  %c = fcmp ogt float %a, %b
+  %r = select i1 %c, i32 %x, i32 %y
+  ret i32 %r
+}
+
+; CHECK-LABEL: setcc_ole:
+; CHECK: fsub {{r[0-9]+}}, r0, r1
+; CHECK: movblte
+; CHECK: .Lfunc_end2:
+define i32 @setcc_ole(float %a, float %b) {
+entry:
+  %c = fcmp ole float %a, %b
+  %r = zext i1 %c to i32
+  ret i32 %r
+}
+
+; CHECK-LABEL: branch_oeq:
+; CHECK: fsub
+; CHECK: bb{{(eq|ne)}} .LBB3_{{[0-9]+}}
+; CHECK: .Lfunc_end3:
+define void @branch_oeq(float %a, float %b, i32* %p) {
+entry:
+  %c = fcmp oeq float %a, %b
+  br i1 %c, label %then, label %exit
+
+then:
+  store volatile i32 1, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
+
+; Float select stays in registers
+; CHECK-LABEL: select_float:
+; CHECK: fsub
+; CHECK: movblt
+; CHECK-NOT: jalr
+; CHECK: .Lfunc_end4:
+define float @select_float(float %a, float %b, float %x, float %y) {
+entry:
+  %c = fcmp olt float %a, %b
+  %r = select i1 %c, float %x, float %y
+  ret float %r
+}
+
+; fmin/fmax don't call libm, NaN operands are checked on their bits
+; CHECK-LABEL: fmin:
+; CHECK-NOT: fminf
+; CHECK: movblt
+; CHECK: movgtu
+; CHECK: movgtu
+; CHECK-NOT: fminf
+; CHECK: .Lfunc_end5:
+define float @fmin(float %a, float %b) {
+entry:
+  %r = call float @llvm.minnum.f32(float %a, float %b)
+  ret float %r
+}
+
+; CHECK-LABEL: fmax_nnan:
+; CHECK-NOT: fmaxf
+; CHECK: movblt
+; CHECK-NOT: movgtu
+; CHECK: .Lfunc_end6:
+define float @fmax_nnan(float %a, float %b) #0 {
+entry:
+  %r = call float @llvm.maxnum.f32(float %a, float %b)
+  ret float %r
+}
+
+; Unordered and ONE results test the operand bits for NaN, as fsub flags
+; don't tell NaN apart
+; CHECK-LABEL: select_one:
+; CHECK-DAG: fsub {{r[0-9]+}}, r0, r1
+; CHECK-DAG: movt {{r[0-9]+}}, #32640
+; CHECK: movgtu
+; CHECK: .Lfunc_end7:
+define i32 @select_one(float %a, float %b, i32 %x, i32 %y) {
+entry:
+  %c = fcmp one float %a, %b
+  %r = select i1 %c, i32 %x, i32 %y
+  ret i32 %r
+}
+
+; CHECK-LABEL: setcc_uno:
+; CHECK-NOT: fsub
+; CHECK: movt {{r[0-9]+}}, #32640
+; CHECK-NOT: fsub
+; CHECK: .Lfunc_end8:
+define i32 @setcc_uno(float %a, float %b) {
+entry:
+  %c = fcmp uno float %a, %b
+  %r = zext i1 %c to i32
+  ret i32 %r
+}
+
+; CHECK-LABEL: branch_ult:
+; CHECK-DAG: fsub {{r[0-9]+}}, r0, r1
+; CHECK-DAG: movt {{r[0-9]+}}, #32640
+; CHECK: b{{[a-z]+}} .LBB9_{{[0-9]+}}
+; CHECK: .Lfunc_end9:
+define void @branch_ult(float %a, float %b, i32* %p) {
+entry:
+  %c = fcmp ult float %a, %b
+  br i1 %c, label %then, label %exit
+
+then:
+  store volatile i32 1, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
+
+; Without NaN the unordered compare is a plain fsub
+; CHECK-LABEL: setcc_ult_nnan:
+; CHECK-NOT: #32640
+; CHECK: fsub {{r[0-9]+}}, r0, r1
+; CHECK: movblt
+; CHECK-NOT: #32640
+; CHECK: .Lfunc_end10:
+define i32 @setcc_ult_nnan(float %a, float %b) #0 {
+entry:
+  %c = fcmp ult float %a, %b
+  %r = zext i1 %c to i32
+  ret i32 %r
+}
+
+attributes #0 = { "no-nans-fp-math"="true" }
@@ -0,0 +1,53 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -enable-unsafe-fp-math < %s \
+; RUN:   | FileCheck %s --check-prefix=FAST
+
+declare float @llvm.sqrt.f32(float)
+
+; Division allowed to use the reciprocal is refined from the exponent seed
+; 0x7ef311c3 - bits(b)
+; CHECK-LABEL: fdiv_arcp:
+; CHECK-NOT: __divsf3
+; CHECK: mov [[SEED:r[0-9]+]], #4547
+; CHECK: movt [[SEED]], #32499
+; CHECK: fmsub
+; CHECK: fmadd
+; CHECK-NOT: __divsf3
+; CHECK: .Lfunc_end0:
+define float @fdiv_arcp(float %a, float %b) {
+entry:
+  %q = fdiv arcp float %a, %b
+  ret float %q
+}
+
+; Exact division is left to the library without fast math
+; CHECK-LABEL: fdiv_exact:
+; CHECK: __divsf3
+; CHECK: .Lfunc_end1:
+; FAST-LABEL: fdiv_exact:
+; FAST-NOT: __divsf3
+; FAST: fmsub
+; FAST: .Lfunc_end1:
+define float @fdiv_exact(float %a, float %b) {
+entry:
+  %q = fdiv float %a, %b
+  ret float %q
+}
+
+; Square root seed is 0x5f3759df - bits(a) / 2
+; CHECK-LABEL: fsqrt:
+; CHECK: sqrtf
+; CHECK: .Lfunc_end2:
+; FAST-LABEL: fsqrt:
+; FAST-NOT: sqrtf
+; FAST-DAG: lsr {{r[0-9]+}}, {{r[0-9]+}}, #1
+; FAST-DAG: movt {{r[0-9]+}}, #24375
+; FAST: fmsub
+; FAST: fmadd
+; FAST-NOT: sqrtf
+; FAST: .Lfunc_end2:
+define float @fsqrt(float %a) {
+entry:
+  %s = call float @llvm.sqrt.f32(float %a)
+  ret float %s
+}
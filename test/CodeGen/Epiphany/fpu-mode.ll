@@ -0,0 +1,113 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O1 -disable-epiphany-hwloops < %s \
+; RUN:   | FileCheck %s
+
+; External function doesn't know the caller's mode: CONFIG is saved, switched
+; to FPU mode (CONFIG[19:17] cleared) with interrupts disabled and restored
+; before the return. Interrupts are enabled again only if they were enabled
+; before the switch.
+; CHECK-LABEL: fp_only:
+; CHECK: movfs [[SAVED:r[0-9]+]], config
+; CHECK: movfs [[STATE:r[0-9]+]], status
+; CHECK-NEXT: gid
+; CHECK-NEXT: movfs [[TMP:r[0-9]+]], config
+; CHECK-NEXT: mov [[MASK:r[0-9]+]], #65535
+; CHECK-NEXT: movt [[MASK]], #65521
+; CHECK-NEXT: and{{(\.l)?}} [[TMP]], [[TMP]], [[MASK]]
+; CHECK-NEXT: movts [[TMP]], config
+; CHECK-NEXT: lsr [[STATE]], [[STATE]], #1
+; CHECK-NEXT: lsl [[STATE]], [[STATE]], #31
+; CHECK-NEXT: bne [[SKIP:.Ltmp[0-9]+]]
+; CHECK-NEXT: gie
+; CHECK-NEXT: [[SKIP]]:
+; CHECK: fadd
+; CHECK: movfs [[STATE2:r[0-9]+]], status
+; CHECK-NEXT: gid
+; CHECK-NEXT: movts [[SAVED]], config
+; CHECK-NEXT: lsr [[STATE2]], [[STATE2]], #1
+; CHECK-NEXT: lsl [[STATE2]], [[STATE2]], #31
+; CHECK-NEXT: bne [[SKIP2:.Ltmp[0-9]+]]
+; CHECK-NEXT: gie
+; CHECK-NEXT: [[SKIP2]]:
+; CHECK: .Lfunc_end0:
+define float @fp_only(float %a, float %b) {
+entry:
+  %sum = fadd float %a, %b
+  ret float %sum
+}
+
+; No mode instructions, CONFIG is left alone
+; CHECK-LABEL: int_only:
+; CHECK-NOT: config
+; CHECK: .Lfunc_end1:
+define i32 @int_only(i32 %a, i32 %b) {
+entry:
+  %sum = add i32 %a, %b
+  ret i32 %sum
+}
+
+; IALU2 mode sets CONFIG[19:17] to 100
+; CHECK-LABEL: fp_then_int:
+; CHECK: and{{(\.l)?}} [[TMP:r[0-9]+]], {{r[0-9]+}}, {{r[0-9]+}}
+; CHECK-NEXT: movts [[TMP]], config
+; CHECK: fmul
+; CHECK: mov [[MASK:r[0-9]+]], #0
+; CHECK-NEXT: movt [[MASK]], #8
+; CHECK-NEXT: orr{{(\.l)?}} [[TMP2:r[0-9]+]], {{r[0-9]+}}, [[MASK]]
+; CHECK-NEXT: movts [[TMP2]], config
+; CHECK: imul
+; CHECK: .Lfunc_end2:
+define i32 @fp_then_int(float %a, float %b, i32 %c, i32 %d) {
+entry:
+  %prod = fmul float %a, %b
+  %conv = fptosi float %prod to i32
+  %mul = mul nsw i32 %conv, %c
+  %res = add nsw i32 %mul, %d
+  ret i32 %res
+}
+
+; The switch is placed before the loop instead of on every iteration
+; CHECK-LABEL: fp_loop:
+; CHECK: movts {{r[0-9]+}}, config
+; CHECK: [[LOOP:.LBB3_[0-9]+]]:
+; CHECK-NOT: config
+; CHECK: fadd
+; CHECK-NOT: config
+; CHECK: b{{[a-z]+}} [[LOOP]]
+; CHECK: .Lfunc_end3:
+define float @fp_loop(float* nocapture readonly %p, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi float [ 0.0, %entry ], [ %acc.next, %loop ]
+  %addr = getelementptr inbounds float, float* %p, i32 %i
+  %v = load volatile float, float* %addr, align 4
+  %acc.next = fadd float %acc, %v
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %res = phi float [ 0.0, %entry ], [ %acc.next, %loop ]
+  ret float %res
+}
+
+; Interrupt handlers run with interrupts disabled, the switches keep them so
+; CHECK-LABEL: fp_handler:
+; CHECK: gid
+; CHECK: bne [[SKIP:.Ltmp[0-9]+]]
+; CHECK-NEXT: gie
+; CHECK-NEXT: [[SKIP]]:
+; CHECK: fmul
+; CHECK: .Lfunc_end4:
+define void @fp_handler(float* %p) #0 {
+entry:
+  %v = load volatile float, float* %p, align 4
+  %m = fmul float %v, %v
+  store volatile float %m, float* %p, align 4
+  ret void
+}
+
+attributes #0 = { "interrupt" }
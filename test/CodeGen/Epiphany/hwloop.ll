@@ -0,0 +1,87 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -disable-epiphany-hwloops < %s \
+; RUN:   | FileCheck %s --check-prefix=NOHW
+
+; Countable single block loop runs on LC/LS/LE, the compare and the branch
+; back are gone and the end label is put on the last instruction, which is
+; double word aligned.
+; CHECK-LABEL: add_one:
+; CHECK: movts {{r[0-9]+}}, ls
+; CHECK: movts {{r[0-9]+}}, le
+; CHECK: movts {{r[0-9]+}}, lc
+; CHECK: .p2align 3
+; CHECK-NEXT: [[LOOP:.LBB0_[0-9]+]]:
+; CHECK-NOT: b{{[a-z]*}} [[LOOP]]
+; CHECK: .p2align 3
+; CHECK-NEXT: .Lloop_end{{[0-9]+}}:
+; CHECK-NEXT: {{[a-z]+}}
+; CHECK-NOT: b{{[a-z]*}} [[LOOP]]
+; CHECK-LABEL: .Lfunc_end0:
+
+; NOHW-LABEL: add_one:
+; NOHW-NOT: movts {{r[0-9]+}}, lc
+; NOHW: b{{[a-z]+}} .LBB0_{{[0-9]+}}
+define void @add_one(i32* nocapture %a, i32* nocapture readonly %b, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr inbounds i32, i32* %b, i32 %i
+  %val = load i32, i32* %src, align 4
+  %inc = add nsw i32 %val, 1
+  %dst = getelementptr inbounds i32, i32* %a, i32 %i
+  store i32 %inc, i32* %dst, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Calls clobber the loop registers
+; CHECK-LABEL: with_call:
+; CHECK-NOT: movts {{r[0-9]+}}, lc
+; CHECK: .Lfunc_end1:
+declare void @foo(i32)
+
+define void @with_call(i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  tail call void @foo(i32 %i)
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Interrupt handlers would clobber the loop of the interrupted code
+; CHECK-LABEL: handler:
+; CHECK-NOT: movts {{r[0-9]+}}, lc
+; CHECK: .Lfunc_end2:
+define void @handler(i32* nocapture %a, i32 %n) #0 {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %dst = getelementptr inbounds i32, i32* %a, i32 %i
+  store volatile i32 %i, i32* %dst, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+attributes #0 = { "interrupt" }
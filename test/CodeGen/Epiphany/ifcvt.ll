@@ -0,0 +1,61 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; Diamond of register moves is a conditional move
+; CHECK-LABEL: diamond:
+; CHECK: sub{{(\.l)?}} {{r[0-9]+}}, {{r[0-9]+}}, {{r[0-9]+}}
+; CHECK: mov{{(gt|lte|lt|gte)}} {{r[0-9]+}}, {{r[0-9]+}}
+; CHECK-NOT: b{{[a-z]+}} .LBB0_{{[0-9]+}}
+; CHECK: .Lfunc_end0:
+define i32 @diamond(i32 %a, i32 %b, i32 %c, i32 %d) {
+entry:
+  %cmp = icmp sgt i32 %a, %b
+  br i1 %cmp, label %then, label %else
+
+then:
+  br label %exit
+
+else:
+  br label %exit
+
+exit:
+  %r = phi i32 [ %c, %then ], [ %d, %else ]
+  ret i32 %r
+}
+
+; Cheap side of the triangle is speculated
+; CHECK-LABEL: triangle:
+; CHECK: add
+; CHECK: mov{{(gtu|lteu|ltu|gteu)}} {{r[0-9]+}}, {{r[0-9]+}}
+; CHECK-NOT: b{{[a-z]+}} .LBB1_{{[0-9]+}}
+; CHECK: .Lfunc_end1:
+define i32 @triangle(i32 %a, i32 %b, i32 %c) {
+entry:
+  %cmp = icmp ugt i32 %a, %b
+  br i1 %cmp, label %then, label %exit
+
+then:
+  %inc = add i32 %c, 5
+  br label %exit
+
+exit:
+  %r = phi i32 [ %inc, %then ], [ %c, %entry ]
+  ret i32 %r
+}
+
+; Stores can't be predicated, the branch stays
+; CHECK-LABEL: store:
+; CHECK: b{{[a-z]+}} .LBB2_{{[0-9]+}}
+; CHECK: str
+; CHECK: .Lfunc_end2:
+define void @store(i32 %a, i32 %b, i32* %p) {
+entry:
+  %cmp = icmp sgt i32 %a, %b
+  br i1 %cmp, label %then, label %exit
+
+then:
+  store i32 %a, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
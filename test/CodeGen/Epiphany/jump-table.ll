@@ -0,0 +1,53 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -filetype=obj < %s \
+; RUN:   | llvm-readobj -r - | FileCheck %s --check-prefix=RELOC
+
+; Dense switch loads the block address from the table and jumps through it
+; CHECK-LABEL: dense:
+; CHECK: mov [[TAB:r[0-9]+]], %low(.LJTI0_0)
+; CHECK: movt [[TAB]], %high(.LJTI0_0)
+; CHECK: ldr [[DEST:r[0-9]+]], [{{r[0-9]+}},+{{r[0-9]+}}]
+; CHECK: jr [[DEST]]
+; CHECK: .section .rodata
+; CHECK: .LJTI0_0:
+; CHECK-NEXT: .word .LBB0_{{[0-9]+}}
+; CHECK-NEXT: .word .LBB0_{{[0-9]+}}
+; CHECK-NEXT: .word .LBB0_{{[0-9]+}}
+; CHECK-NEXT: .word .LBB0_{{[0-9]+}}
+; CHECK-NEXT: .word .LBB0_{{[0-9]+}}
+; CHECK-NEXT: .word .LBB0_{{[0-9]+}}
+
+; Entries are absolute addresses
+; RELOC: Section {{.*}} .rela.rodata {
+; RELOC-NEXT: 0x0 R_EPIPHANY_32 .text
+; RELOC-NEXT: 0x4 R_EPIPHANY_32 .text
+define i32 @dense(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %bb0
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+    i32 4, label %bb4
+    i32 5, label %bb5
+  ]
+
+bb0:
+  br label %exit
+bb1:
+  br label %exit
+bb2:
+  br label %exit
+bb3:
+  br label %exit
+bb4:
+  br label %exit
+bb5:
+  br label %exit
+default:
+  br label %exit
+
+exit:
+  %r = phi i32 [ 10, %bb0 ], [ 23, %bb1 ], [ 7, %bb2 ], [ 41, %bb3 ], [ 3, %bb4 ], [ 99, %bb5 ], [ 0, %default ]
+  ret i32 %r
+}
@@ -0,0 +1,43 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; Double word aligned i64 goes through an even/odd register pair, the
+; displacement is counted in double words
+; CHECK-LABEL: load_aligned:
+; CHECK: ldrd {{r[0-9]*[02468]}}, [r0,#1]
+define i64 @load_aligned(i64* nocapture readonly %p) {
+entry:
+  %addr = getelementptr inbounds i64, i64* %p, i32 1
+  %val = load i64, i64* %addr, align 8
+  ret i64 %val
+}
+
+; CHECK-LABEL: store_aligned:
+; CHECK: strd {{r[0-9]*[02468]}}, [r0,#2]
+define void @store_aligned(i64* nocapture %p, i64 %val) {
+entry:
+  %addr = getelementptr inbounds i64, i64* %p, i32 2
+  store i64 %val, i64* %addr, align 8
+  ret void
+}
+
+; Word aligned i64 is split
+; CHECK-LABEL: load_unaligned:
+; CHECK-NOT: ldrd
+; CHECK-DAG: ldr {{r[0-9]+}}, [r0,#0]
+; CHECK-DAG: ldr {{r[0-9]+}}, [r0,#1]
+; CHECK-NOT: ldrd
+; CHECK: .Lfunc_end2:
+define i64 @load_unaligned(i64* nocapture readonly %p) {
+entry:
+  %val = load i64, i64* %p, align 4
+  ret i64 %val
+}
+
+; CHECK-LABEL: store_unaligned:
+; CHECK-NOT: strd
+; CHECK: .Lfunc_end3:
+define void @store_unaligned(i64* nocapture %p, i64 %val) {
+entry:
+  store i64 %val, i64* %p, align 4
+  ret void
+}
@@ -0,0 +1,74 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -disable-epiphany-ldst-opt < %s \
+; RUN:   | FileCheck %s --check-prefix=NOOPT
+
+; Adjacent words with the lower one double word aligned are merged
+; CHECK-LABEL: pair_loads:
+; CHECK: ldrd {{r[0-9]*[02468]}}, [r0,#1]
+; CHECK-NOT: ldr {{r[0-9]+}}, [r0,
+; CHECK: .Lfunc_end0:
+; NOOPT-LABEL: pair_loads:
+; NOOPT-NOT: ldrd
+; NOOPT: .Lfunc_end0:
+define i32 @pair_loads(i32* nocapture readonly %p) {
+entry:
+  %lo.addr = getelementptr inbounds i32, i32* %p, i32 2
+  %hi.addr = getelementptr inbounds i32, i32* %p, i32 3
+  %hi = load i32, i32* %hi.addr, align 4
+  %lo = load i32, i32* %lo.addr, align 8
+  %sum = add nsw i32 %lo, %hi
+  ret i32 %sum
+}
+
+; CHECK-LABEL: pair_stores:
+; CHECK: strd {{r[0-9]*[02468]}}, [r0,#0]
+; CHECK: .Lfunc_end1:
+; NOOPT-LABEL: pair_stores:
+; NOOPT-NOT: strd
+; NOOPT: .Lfunc_end1:
+define void @pair_stores(i32* nocapture %p, i32 %a, i32 %b) {
+entry:
+  %hi.addr = getelementptr inbounds i32, i32* %p, i32 1
+  store i32 %a, i32* %p, align 8
+  store i32 %b, i32* %hi.addr, align 4
+  ret void
+}
+
+; Lower word is not known to be double word aligned
+; CHECK-LABEL: no_pair_align:
+; CHECK-NOT: ldrd
+; CHECK: .Lfunc_end2:
+define i32 @no_pair_align(i32* nocapture readonly %p) {
+entry:
+  %hi.addr = getelementptr inbounds i32, i32* %p, i32 1
+  %lo = load i32, i32* %p, align 4
+  %hi = load i32, i32* %hi.addr, align 4
+  %sum = add nsw i32 %lo, %hi
+  ret i32 %sum
+}
+
+; Store in between may alias the second load
+; CHECK-LABEL: no_pair_alias:
+; CHECK-NOT: ldrd
+; CHECK: .Lfunc_end3:
+define i32 @no_pair_alias(i32* %p, i32* %q) {
+entry:
+  %hi.addr = getelementptr inbounds i32, i32* %p, i32 1
+  %lo = load i32, i32* %p, align 8
+  store i32 0, i32* %q, align 4
+  %hi = load i32, i32* %hi.addr, align 4
+  %sum = add nsw i32 %lo, %hi
+  ret i32 %sum
+}
+
+; Volatile accesses are kept apart
+; CHECK-LABEL: no_pair_volatile:
+; CHECK-NOT: strd
+; CHECK: .Lfunc_end4:
+define void @no_pair_volatile(i32* %p, i32 %a, i32 %b) {
+entry:
+  %hi.addr = getelementptr inbounds i32, i32* %p, i32 1
+  store volatile i32 %a, i32* %p, align 8
+  store volatile i32 %b, i32* %hi.addr, align 4
+  ret void
+}
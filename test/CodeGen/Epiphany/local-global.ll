@@ -0,0 +1,60 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -code-model=small < %s \
+; RUN:   | FileCheck %s --check-prefix=SMALL
+
+@buf = global [16 x i32] zeroinitializer, align 4
+@banked = global [16 x i32] zeroinitializer, section ".data_bank1", align 4
+
+; Globals may be in the external memory, both halves are needed
+; CHECK-LABEL: addr_buf:
+; CHECK: mov r0, %low(buf)
+; CHECK-NEXT: movt r0, %high(buf)
+; CHECK: .Lfunc_end0:
+; SMALL-LABEL: addr_buf:
+; SMALL: mov r0, %low(buf)
+; SMALL-NOT: movt
+; SMALL: .Lfunc_end0:
+define i32* @addr_buf() {
+entry:
+  ret i32* getelementptr inbounds ([16 x i32], [16 x i32]* @buf, i32 0, i32 0)
+}
+
+; Bank sections are in the local memory with any code model
+; CHECK-LABEL: addr_banked:
+; CHECK: mov r0, %low(banked)
+; CHECK-NOT: movt
+; CHECK: .Lfunc_end1:
+define i32* @addr_banked() {
+entry:
+  ret i32* getelementptr inbounds ([16 x i32], [16 x i32]* @banked, i32 0, i32 0)
+}
+
+; Constant offset is folded into the relocation
+; SMALL-LABEL: addr_offset:
+; SMALL: mov r0, %low(buf+8)
+; SMALL-NOT: add
+; SMALL: .Lfunc_end2:
+define i32* @addr_offset() {
+entry:
+  ret i32* getelementptr inbounds ([16 x i32], [16 x i32]* @buf, i32 0, i32 2)
+}
+
+; SMALL-LABEL: addr_negative:
+; SMALL: mov r0, %low(buf-4)
+; SMALL: .Lfunc_end3:
+define i32* @addr_negative() {
+entry:
+  ret i32* getelementptr ([16 x i32], [16 x i32]* @buf, i32 0, i32 -1)
+}
+
+; Loads need the single MOV as well
+; SMALL-LABEL: load_offset:
+; SMALL: mov [[R:r[0-9]+]], %low(buf{{(\+12)?}})
+; SMALL-NOT: movt
+; SMALL: ldr r0, {{\[}}[[R]],#{{[0-9]+}}]
+; SMALL: .Lfunc_end4:
+define i32 @load_offset() {
+entry:
+  %v = load i32, i32* getelementptr inbounds ([16 x i32], [16 x i32]* @buf, i32 0, i32 3), align 4
+  ret i32 %v
+}
@@ -0,0 +1,86 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -enable-unsafe-fp-math < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -enable-unsafe-fp-math -epiphany-enable-mcr=false < %s \
+; RUN:   | FileCheck %s --check-prefix=NOMCR
+
+; The multiply-add chain is split into two parallel ones, the inner
+; multiply-add becomes a product feeding the new chain
+; CHECK-LABEL: fdot4:
+; CHECK: fmul
+; CHECK: fmul
+; CHECK: fmadd
+; CHECK: fadd
+; CHECK: .Lfunc_end0:
+
+; NOMCR-LABEL: fdot4:
+; NOMCR: fmul
+; NOMCR-NOT: fmul
+; NOMCR: fmadd
+; NOMCR: fmadd
+; NOMCR: fmadd
+; NOMCR: .Lfunc_end0:
+define float @fdot4(float* nocapture readonly %p, float* nocapture readonly %q) {
+entry:
+  %p1 = getelementptr inbounds float, float* %p, i32 1
+  %p2 = getelementptr inbounds float, float* %p, i32 2
+  %p3 = getelementptr inbounds float, float* %p, i32 3
+  %q1 = getelementptr inbounds float, float* %q, i32 1
+  %q2 = getelementptr inbounds float, float* %q, i32 2
+  %q3 = getelementptr inbounds float, float* %q, i32 3
+  %a0 = load float, float* %p, align 4
+  %a1 = load float, float* %p1, align 4
+  %a2 = load float, float* %p2, align 4
+  %a3 = load float, float* %p3, align 4
+  %b0 = load float, float* %q, align 4
+  %b1 = load float, float* %q1, align 4
+  %b2 = load float, float* %q2, align 4
+  %b3 = load float, float* %q3, align 4
+  %m0 = fmul fast float %a0, %b0
+  %m1 = fmul fast float %a1, %b1
+  %s1 = fadd fast float %m0, %m1
+  %m2 = fmul fast float %a2, %b2
+  %s2 = fadd fast float %s1, %m2
+  %m3 = fmul fast float %a3, %b3
+  %s3 = fadd fast float %s2, %m3
+  ret float %s3
+}
+
+; Integer multiply-adds are reassociated without fast math
+; CHECK-LABEL: idot4:
+; CHECK: imul
+; CHECK: imul
+; CHECK: imadd
+; CHECK: {{[[:space:]]}}add{{(\.l)?}} r
+; CHECK: .Lfunc_end1:
+
+; NOMCR-LABEL: idot4:
+; NOMCR: imul
+; NOMCR-NOT: imul
+; NOMCR: imadd
+; NOMCR: imadd
+; NOMCR: imadd
+; NOMCR: .Lfunc_end1:
+define i32 @idot4(i32* nocapture readonly %p, i32* nocapture readonly %q) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i32 1
+  %p2 = getelementptr inbounds i32, i32* %p, i32 2
+  %p3 = getelementptr inbounds i32, i32* %p, i32 3
+  %q1 = getelementptr inbounds i32, i32* %q, i32 1
+  %q2 = getelementptr inbounds i32, i32* %q, i32 2
+  %q3 = getelementptr inbounds i32, i32* %q, i32 3
+  %a0 = load i32, i32* %p, align 4
+  %a1 = load i32, i32* %p1, align 4
+  %a2 = load i32, i32* %p2, align 4
+  %a3 = load i32, i32* %p3, align 4
+  %b0 = load i32, i32* %q, align 4
+  %b1 = load i32, i32* %q1, align 4
+  %b2 = load i32, i32* %q2, align 4
+  %b3 = load i32, i32* %q3, align 4
+  %m0 = mul i32 %a0, %b0
+  %m1 = mul i32 %a1, %b1
+  %s1 = add i32 %m0, %m1
+  %m2 = mul i32 %a2, %b2
+  %s2 = add i32 %s1, %m2
+  %m3 = mul i32 %a3, %b3
+  %s3 = add i32 %s2, %m3
+  ret i32 %s3
+}
@@ -0,0 +1,50 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; x * 7 = (x << 3) - x
+; CHECK-LABEL: mul7:
+; CHECK: lsl [[T:r[0-9]+]], r0, #3
+; CHECK-NEXT: sub{{(\.l)?}} r0, [[T]], r0
+; CHECK-NOT: imul
+; CHECK-NOT: config
+; CHECK: .Lfunc_end0:
+define i32 @mul7(i32 %x) {
+entry:
+  %m = mul i32 %x, 7
+  ret i32 %m
+}
+
+; x * 640 = ((x << 2) + x) << 7
+; CHECK-LABEL: mul640:
+; CHECK: lsl [[T:r[0-9]+]], r0, #2
+; CHECK-NEXT: add{{(\.l)?}} [[S:r[0-9]+]], [[T]], r0
+; CHECK-NEXT: lsl r0, [[S]], #7
+; CHECK-NOT: imul
+; CHECK: .Lfunc_end1:
+define i32 @mul640(i32 %x) {
+entry:
+  %m = mul i32 %x, 640
+  ret i32 %m
+}
+
+; Negative constant is negated at the end
+; CHECK-LABEL: mul_neg3:
+; CHECK-NOT: imul
+; CHECK: sub{{(\.l)?}} r0, {{r[0-9]+}}, {{r[0-9]+}}
+; CHECK-NOT: imul
+; CHECK: .Lfunc_end2:
+define i32 @mul_neg3(i32 %x) {
+entry:
+  %m = mul i32 %x, -3
+  ret i32 %m
+}
+
+; Too many digits for the IMUL latency and the mode switch
+; CHECK-LABEL: mul_dense:
+; CHECK: movts {{r[0-9]+}}, config
+; CHECK: imul
+; CHECK: .Lfunc_end3:
+define i32 @mul_dense(i32 %x) {
+entry:
+  %m = mul i32 %x, 305419897
+  ret i32 %m
+}
@@ -0,0 +1,67 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -enable-pipeliner=false < %s \
+; RUN:   | FileCheck %s --check-prefix=NOSWP
+
+; The load of the next iteration is started in the prologue, so the kernel
+; doesn't wait for it. The kernel is still made a hardware loop.
+; CHECK-LABEL: scale:
+; CHECK: ldr
+; CHECK: .p2align 3
+; CHECK-NEXT: .LBB0_{{[0-9]+}}:
+; CHECK: fmul
+; CHECK: .Lloop_end{{[0-9]+}}:
+; CHECK: .Lfunc_end0:
+
+; NOSWP-LABEL: scale:
+; NOSWP-NOT: ldr
+; NOSWP: .p2align 3
+; NOSWP-NEXT: .LBB0_{{[0-9]+}}:
+; NOSWP: ldr
+; NOSWP: fmul
+; NOSWP: .Lfunc_end0:
+define void @scale(float* nocapture %a, float* nocapture readonly %b, float %c, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr inbounds float, float* %b, i32 %i
+  %val = load float, float* %src, align 4
+  %mul = fmul float %val, %c
+  %dst = getelementptr inbounds float, float* %a, i32 %i
+  store float %mul, float* %dst, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Calls in the loop keep it as it is
+; CHECK-LABEL: with_call:
+; CHECK-NOT: ldr
+; CHECK: .LBB1_{{[0-9]+}}:
+; CHECK: ldr
+; CHECK: jalr
+; CHECK: .Lfunc_end1:
+declare void @use(float)
+
+define void @with_call(float* nocapture readonly %b, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr inbounds float, float* %b, i32 %i
+  %val = load float, float* %src, align 4
+  call void @use(float %val)
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
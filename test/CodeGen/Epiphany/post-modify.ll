@@ -0,0 +1,48 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; Immediate increment is scaled by the access size
+; CHECK-LABEL: store_inc:
+; CHECK: str r1, [r0],#1
+; CHECK-NOT: add
+; CHECK: .Lfunc_end0:
+define i32* @store_inc(i32* %p, i32 %v) {
+entry:
+  store i32 %v, i32* %p, align 4
+  %next = getelementptr inbounds i32, i32* %p, i32 1
+  ret i32* %next
+}
+
+; CHECK-LABEL: load_dec:
+; CHECK: ldrh {{r[0-9]+}}, [r0],#-1
+; CHECK: .Lfunc_end1:
+define i16* @load_dec(i16* %p, i16* nocapture %out) {
+entry:
+  %v = load i16, i16* %p, align 2
+  store i16 %v, i16* %out, align 2
+  %next = getelementptr inbounds i16, i16* %p, i32 -1
+  ret i16* %next
+}
+
+; Register increment
+; CHECK-LABEL: store_byte_reg:
+; CHECK: strb r1, [r0],+r2
+; CHECK: .Lfunc_end2:
+define i8* @store_byte_reg(i8* %p, i8 %v, i32 %step) {
+entry:
+  store i8 %v, i8* %p, align 1
+  %next = getelementptr inbounds i8, i8* %p, i32 %step
+  ret i8* %next
+}
+
+; Increment that is not a multiple of the access size stays an add
+; CHECK-LABEL: store_odd_inc:
+; CHECK: str r1, [r0,#0]
+; CHECK: add r0, r0, #2
+; CHECK: .Lfunc_end3:
+define i8* @store_odd_inc(i8* %p, i32 %v) {
+entry:
+  %addr = bitcast i8* %p to i32*
+  store i32 %v, i32* %addr, align 4
+  %next = getelementptr inbounds i8, i8* %p, i32 2
+  ret i8* %next
+}
@@ -0,0 +1,19 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s
+
+; FPU result is ready 4 cycles later, independent integer instructions are
+; scheduled into the gap and issue alongside
+; CHECK-LABEL: fill_fpu_latency:
+; CHECK: fadd{{(\.l)?}} [[S:r[0-9]+]]
+; CHECK-NEXT: {{(add|sub|eor|orr|and|lsl|lsr)}}{{(\.l)?}} {{r[0-9]+}}
+; CHECK: fmul{{(\.l)?}} {{.*}}[[S]]
+; CHECK: .Lfunc_end0:
+define float @fill_fpu_latency(float %a, float %b, i32 %x, i32* %p) {
+entry:
+  %s = fadd float %a, %b
+  %m = fmul float %s, %s
+  %x1 = xor i32 %x, 85
+  %x2 = add i32 %x1, %x
+  %x3 = shl i32 %x2, 3
+  store i32 %x3, i32* %p, align 4
+  ret float %m
+}
@@ -0,0 +1,69 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -epiphany-use-small-section < %s \
+; RUN:   | FileCheck %s
+; RUN: llc -march=epiphany -mcpu=E16 -O2 < %s | FileCheck %s --check-prefix=NOSMALL
+
+@small = global i32 5, align 4
+@zero = global i32 0, align 4
+@big = global [4 x i32] [i32 1, i32 2, i32 3, i32 4], align 4
+@explicit = global i32 7, section ".sdata", align 4
+
+; Small globals are loaded from SB
+; CHECK-LABEL: load_small:
+; CHECK-NOT: movt
+; CHECK: ldr r0, [sb,{{.*}}%gprel(small){{.*}}]
+; CHECK: .Lfunc_end0:
+; NOSMALL-LABEL: load_small:
+; NOSMALL: mov [[R:r[0-9]+]], %low(small)
+; NOSMALL: movt [[R]], %high(small)
+; NOSMALL-NOT: sb
+; NOSMALL: .Lfunc_end0:
+define i32 @load_small() {
+entry:
+  %v = load i32, i32* @small, align 4
+  ret i32 %v
+}
+
+; CHECK-LABEL: store_zero:
+; CHECK: str {{r[0-9]+}}, [sb,{{.*}}%gprel(zero){{.*}}]
+; CHECK: .Lfunc_end1:
+define void @store_zero(i32 %x) {
+entry:
+  store i32 %x, i32* @zero, align 4
+  ret void
+}
+
+; Larger globals keep the absolute address
+; CHECK-LABEL: load_big:
+; CHECK: mov [[R:r[0-9]+]], %low(big)
+; CHECK: movt [[R]], %high(big)
+; CHECK: .Lfunc_end2:
+define i32 @load_big() {
+entry:
+  %p = getelementptr inbounds [4 x i32], [4 x i32]* @big, i32 0, i32 1
+  %v = load i32, i32* %p, align 4
+  ret i32 %v
+}
+
+; Explicit .sdata is addressed from SB only when small data is enabled
+; CHECK-LABEL: load_explicit:
+; CHECK: ldr r0, [sb,{{.*}}%gprel(explicit){{.*}}]
+; CHECK: .Lfunc_end3:
+; NOSMALL-LABEL: load_explicit:
+; NOSMALL: mov [[R:r[0-9]+]], %low(explicit)
+; NOSMALL-NOT: sb
+; NOSMALL: .Lfunc_end3:
+define i32 @load_explicit() {
+entry:
+  %v = load i32, i32* @explicit, align 4
+  ret i32 %v
+}
+
+; CHECK: .section .sdata,"aw",@progbits
+; CHECK: small:
+; CHECK: .section .sbss,"aw",@nobits
+; CHECK: zero:
+; CHECK: .data
+; CHECK: big:
+
+; NOSMALL-NOT: .sbss
+; NOSMALL: small:
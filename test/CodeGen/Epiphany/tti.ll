@@ -0,0 +1,83 @@
+; RUN: opt -mtriple=epiphany -mcpu=E16 -cost-model -analyze < %s \
+; RUN:   | FileCheck %s --check-prefix=COST
+; RUN: opt -mtriple=epiphany -mcpu=E16 -enable-unsafe-fp-math -cost-model -analyze < %s \
+; RUN:   | FileCheck %s --check-prefix=UNSAFE
+; RUN: opt -mtriple=epiphany -mcpu=E16 -loop-unroll -S < %s \
+; RUN:   | FileCheck %s --check-prefix=UNROLL
+
+; There's no divider, division by constant is a multiply by the magic number
+; COST-LABEL: 'arith'
+; COST: cost of 20 for instruction: %div = sdiv i32 %a, %b
+; COST: cost of 8 for instruction: %div7 = sdiv i32 %a, 7
+; COST: cost of 1 for instruction: %udiv8 = udiv i32 %a, 8
+; COST: cost of 3 for instruction: %sdiv8 = sdiv i32 %a, 8
+; COST: cost of 2 for instruction: %mul = mul i32 %a, %b
+; COST: cost of 20 for instruction: %fdiv = fdiv float %x, %y
+; COST: cost of 20 for instruction: %dadd = fadd double %d, %d
+; Float division is inlined only with unsafe math
+; UNSAFE-LABEL: 'arith'
+; UNSAFE: cost of 8 for instruction: %fdiv = fdiv float %x, %y
+define void @arith(i32 %a, i32 %b, float %x, float %y, double %d) {
+entry:
+  %div = sdiv i32 %a, %b
+  %div7 = sdiv i32 %a, 7
+  %udiv8 = udiv i32 %a, 8
+  %sdiv8 = sdiv i32 %a, 8
+  %mul = mul i32 %a, %b
+  %fdiv = fdiv float %x, %y
+  %dadd = fadd double %d, %d
+  ret void
+}
+
+; One FPU op in the loop, it's unrolled 4 times to cover the FPU latency
+; UNROLL-LABEL: @scale(
+; UNROLL: fmul float
+; UNROLL: fmul float
+; UNROLL: fmul float
+; UNROLL: fmul float
+; UNROLL: br i1
+define void @scale(float* nocapture %a, float* nocapture readonly %b, float %c, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr inbounds float, float* %b, i32 %i
+  %val = load float, float* %src, align 4
+  %mul = fmul float %val, %c
+  %dst = getelementptr inbounds float, float* %a, i32 %i
+  store float %mul, float* %dst, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Loops with calls are left alone
+; UNROLL-LABEL: @with_call(
+; UNROLL: call void @use(
+; UNROLL-NOT: call void @use(
+; UNROLL: ret void
+declare void @use(float)
+
+define void @with_call(float* nocapture readonly %b, float %c, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %src = getelementptr inbounds float, float* %b, i32 %i
+  %val = load float, float* %src, align 4
+  %mul = fmul float %val, %c
+  call void @use(float %mul)
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
@@ -0,0 +1,25 @@
+; RUN: llc -march=epiphany -mcpu=E16 -O2 -show-mc-encoding < %s | FileCheck %s
+
+declare void @llvm.epiphany.dma.start(i32, i8*)
+declare void @llvm.epiphany.dma.wait(i32)
+
+; DMA registers are in the MMR group 1, DMA1CONFIG is register 8 of it
+; CHECK-LABEL: start:
+; CHECK: movts {{r[0-7]}}, dma0config // encoding: [0x0f,0x{{[0-9a-f]+}},0x12,0x00]
+; CHECK: movts {{r[0-7]}}, dma1config // encoding: [0x0f,0x{{[0-9a-f]+}},0x12,0x04]
+define void @start(i8* %desc) {
+entry:
+  call void @llvm.epiphany.dma.start(i32 0, i8* %desc)
+  call void @llvm.epiphany.dma.start(i32 1, i8* %desc)
+  ret void
+}
+
+; CHECK-LABEL: wait:
+; CHECK: movfs {{r[0-7]}}, dma0status // encoding: [0x1f,0x{{[0-9a-f]+}},0x12,0x00]
+; CHECK: movfs {{r[0-7]}}, dma1status // encoding: [0x1f,0x{{[0-9a-f]+}},0x12,0x04]
+define void @wait() {
+entry:
+  call void @llvm.epiphany.dma.wait(i32 0)
+  call void @llvm.epiphany.dma.wait(i32 1)
+  ret void
+}
@@ -0,0 +1,16 @@
+; RUN: not llc -march=epiphany -mcpu=E16 -O2 -epiphany-use-small-section -filetype=obj \
+; RUN:   -o /dev/null < %s 2>&1 | FileCheck %s
+
+; e-ld has no SB relative relocation, so small data can only be emitted as
+; assembly
+; CHECK: SB relative small data can't be relocated in object files
+
+@small = global [2 x i32] [i32 1, i32 2], align 4
+
+define i32 @sum() {
+entry:
+  %a = load i32, i32* getelementptr inbounds ([2 x i32], [2 x i32]* @small, i32 0, i32 0), align 4
+  %b = load i32, i32* getelementptr inbounds ([2 x i32], [2 x i32]* @small, i32 0, i32 1), align 4
+  %s = add i32 %a, %b
+  ret i32 %s
+}